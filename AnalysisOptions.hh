@@ -0,0 +1,85 @@
+// -*- C++ -*-
+#ifndef RIVET_AnalysisOptions_HH
+#define RIVET_AnalysisOptions_HH
+
+#include "Rivet/Exceptions.hh"
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace Rivet {
+
+
+  /// @name Runtime analysis options
+  ///
+  /// Options are read from the RIVET_ANALYSIS_OPTIONS environment variable,
+  /// as whitespace-separated entries in the same form as Rivet 3 analysis
+  /// names with options, e.g.
+  ///
+  ///   RIVET_ANALYSIS_OPTIONS="LH2017_ZHJETS:RADII=0.4,0.7:OBS=spectra CMS_RAD:RADII=0.4"
+  ///
+  /// List values are comma-separated.
+  //@{
+
+  /// Split @a s at each @a sep, dropping empty fields
+  inline std::vector<std::string> splitOptionList(const std::string& s, char sep=',') {
+    std::vector<std::string> rtn;
+    std::istringstream ss(s);
+    std::string field;
+    while (std::getline(ss, field, sep)) {
+      if (!field.empty()) rtn.push_back(field);
+    }
+    return rtn;
+  }
+
+
+  /// Value of option @a key for analysis @a ananame, or @a def if it is not set
+  inline std::string analysisOption(const std::string& ananame, const std::string& key, const std::string& def="") {
+    const char* env = std::getenv("RIVET_ANALYSIS_OPTIONS");
+    if (!env) return def;
+    std::istringstream entries(env);
+    std::string entry;
+    while (entries >> entry) {
+      const std::vector<std::string> fields = splitOptionList(entry, ':');
+      if (fields.empty() || fields.front() != ananame) continue;
+      for (size_t i = 1; i < fields.size(); ++i) {
+        const size_t eq = fields[i].find('=');
+        if (eq == std::string::npos)
+          throw UserError("Analysis option '" + fields[i] + "' for " + ananame + " is not of the form KEY=VALUE");
+        if (fields[i].substr(0, eq) == key) return fields[i].substr(eq+1);
+      }
+    }
+    return def;
+  }
+
+
+  /// Comma-separated list option @a key for analysis @a ananame, or @a def if it is not set
+  inline std::vector<std::string> analysisOptionList(const std::string& ananame, const std::string& key,
+                                                     const std::vector<std::string>& def) {
+    const std::string value = analysisOption(ananame, key);
+    return value.empty() ? def : splitOptionList(value);
+  }
+
+
+  /// Comma-separated numeric list option @a key for analysis @a ananame, or @a def if it is not set
+  inline std::vector<double> analysisOptionValues(const std::string& ananame, const std::string& key,
+                                                  const std::vector<double>& def) {
+    const std::string value = analysisOption(ananame, key);
+    if (value.empty()) return def;
+    std::vector<double> rtn;
+    for (const std::string& field : splitOptionList(value)) {
+      char* end = 0;
+      rtn.push_back(std::strtod(field.c_str(), &end));
+      if (end == field.c_str() || *end != '\0')
+        throw UserError("Analysis option " + ananame + ":" + key + " needs numbers, not '" + field + "'");
+    }
+    return rtn;
+  }
+
+  //@}
+
+
+}
+
+#endif
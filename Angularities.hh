@@ -0,0 +1,138 @@
+// -*- C++ -*-
+#ifndef RIVET_Angularities_HH
+#define RIVET_Angularities_HH
+
+#include "ConstituentView.hh"
+#include <algorithm>
+#include <cmath>
+
+namespace Rivet {
+
+
+  /// @brief Constituent sums for the generalised angularities of one jet
+  ///
+  /// \f$ \lambda^\kappa_\beta = \sum_i z_i^\kappa (\Delta R_i / R)^\beta \f$,
+  /// with \f$ z_i = p_{T,i} / \sum_j p_{T,j} \f$, for the (kappa, beta) pairs
+  /// used in the LH2017 study.
+  struct AngularitySums {
+    AngularitySums() : n(0), pt(0), pt2(0), ptdr2(0), ptdr(0), ptsqrtdr(0) {  }
+
+    size_t n;
+    double pt, pt2, ptdr2, ptdr, ptsqrtdr;
+
+    /// \f$ \lambda^1_2 \f$ for jet radius @a R
+    double ga1020(double R) const { return ptdr2 / pt / (R*R); }
+    /// \f$ \lambda^1_1 \f$ for jet radius @a R
+    double ga1010(double R) const { return ptdr / pt / R; }
+    /// \f$ \lambda^1_{0.5} \f$ for jet radius @a R
+    double ga1005(double R) const { return ptsqrtdr / pt / std::sqrt(R); }
+    /// \f$ \lambda^0_0 \f$, i.e. the constituent multiplicity
+    double ga0000() const { return n; }
+    /// \f$ \lambda^2_0 \f$, i.e. the pT dispersion squared
+    double ga2000() const { return pt2 / (pt*pt); }
+  };
+
+
+  /// @name Angularity kernels
+  ///
+  /// Single passes over the constituent arrays, relative to a precomputed
+  /// jet axis. The sums are accumulated in ANGULARITY_LANES independent
+  /// lanes so the loops can be vectorised without reassociating the
+  /// additions (this needs -fno-math-errno for the square roots). The lane
+  /// order is fixed, so the results do not depend on the instruction set.
+  //@{
+
+  static const size_t ANGULARITY_LANES = 4;
+
+
+  /// \f$ \Delta R \f$ of entry @a k from the axis (@a aeta, @a aphi), all phis in [0, 2pi)
+  inline double angularityDeltaR(const double* eta, const double* phi, size_t k, double aeta, double aphi) {
+    const double deta = eta[k] - aeta;
+    const double dphi0 = std::fabs(phi[k] - aphi);
+    const double dphi = std::min(dphi0, 2*M_PI - dphi0);
+    return std::sqrt(deta*deta + dphi*dphi);
+  }
+
+
+  /// Constituent i is entry index[i] of the arrays
+  struct IndexedConstituents {
+    const int* index;
+    size_t operator () (size_t i) const { return index[i]; }
+  };
+
+
+  /// All the LH2017 angularity sums of @a n constituents, located in the arrays by @a at
+  template <typename AT>
+  inline AngularitySums angularitySums(const double* pt, const double* eta, const double* phi, AT at, size_t n,
+                                       double aeta, double aphi) {
+    const size_t W = ANGULARITY_LANES;
+    double spt[W] = {0}, spt2[W] = {0}, sdr2[W] = {0}, sdr[W] = {0}, ssqrtdr[W] = {0};
+    auto add = [&](size_t l, size_t k) {
+      const double dr = angularityDeltaR(eta, phi, k, aeta, aphi);
+      const double z = pt[k];
+      spt[l] += z;
+      spt2[l] += z*z;
+      sdr2[l] += z*dr*dr;
+      sdr[l] += z*dr;
+      ssqrtdr[l] += z*std::sqrt(dr);
+    };
+    // Full blocks have a fixed trip count, so the lanes map onto SIMD registers
+    const size_t nblock = n - n % W;
+    for (size_t i0 = 0; i0 < nblock; i0 += W)
+      for (size_t l = 0; l < W; ++l) add(l, at(i0+l));
+    for (size_t i = nblock; i < n; ++i) add(i - nblock, at(i));
+
+    AngularitySums rtn;
+    rtn.n = n;
+    for (size_t l = 0; l < W; ++l) {
+      rtn.pt += spt[l];
+      rtn.pt2 += spt2[l];
+      rtn.ptdr2 += sdr2[l];
+      rtn.ptdr += sdr[l];
+      rtn.ptsqrtdr += ssqrtdr[l];
+    }
+    return rtn;
+  }
+
+  /// All the LH2017 angularity sums of the constituents @a c about the axis (@a aeta, @a aphi)
+  inline AngularitySums angularitySums(const ConstituentView& c, double aeta, double aphi) {
+    const IndexedConstituents at = { c.index };
+    return angularitySums(c.pt, c.eta, c.phi, at, c.size, aeta, aphi);
+  }
+
+
+  /// @brief Generalised angularity \f$ \lambda^\kappa_\beta \f$ for any (@a kappa, @a beta)
+  ///
+  /// Same pass as angularitySums(), but with general powers, so slower.
+  template <typename AT>
+  inline double angularity(const double* pt, const double* eta, const double* phi, AT at, size_t n,
+                           double aeta, double aphi, double R, double kappa, double beta) {
+    const size_t W = ANGULARITY_LANES;
+    double spt[W] = {0}, sang[W] = {0};
+    auto add = [&](size_t l, size_t k) {
+      const double dr = angularityDeltaR(eta, phi, k, aeta, aphi);
+      spt[l] += pt[k];
+      sang[l] += std::pow(pt[k], kappa) * std::pow(dr/R, beta);
+    };
+    const size_t nblock = n - n % W;
+    for (size_t i0 = 0; i0 < nblock; i0 += W)
+      for (size_t l = 0; l < W; ++l) add(l, at(i0+l));
+    for (size_t i = nblock; i < n; ++i) add(i - nblock, at(i));
+
+    double sumpt = 0, sum = 0;
+    for (size_t l = 0; l < W; ++l) { sumpt += spt[l]; sum += sang[l]; }
+    return sum / std::pow(sumpt, kappa);
+  }
+
+  /// Generalised angularity of the constituents @a c about the axis (@a aeta, @a aphi), for jet radius @a R
+  inline double angularity(const ConstituentView& c, double aeta, double aphi, double R, double kappa, double beta) {
+    const IndexedConstituents at = { c.index };
+    return angularity(c.pt, c.eta, c.phi, at, c.size, aeta, aphi, R, kappa, beta);
+  }
+
+  //@}
+
+
+}
+
+#endif
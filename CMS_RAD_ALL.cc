@@ -0,0 +1,10 @@
+// -*- C++ -*-
+#include "CMS_RAD_ALL.hh"
+
+namespace Rivet {
+
+
+  // This global object acts as a hook for the plugin system.
+  DECLARE_RIVET_PLUGIN(CMS_RAD_ALL);
+
+}
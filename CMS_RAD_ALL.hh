@@ -0,0 +1,432 @@
+// -*- C++ -*-
+#ifndef RIVET_CMS_RAD_ALL_HH
+#define RIVET_CMS_RAD_ALL_HH
+
+#include "Rivet/Analysis.hh"
+#include "Rivet/Projections/FinalState.hh"
+#include "Rivet/Projections/FastJets.hh"
+#include "Rivet/Tools/BinnedHistogram.hh"
+#include "MultiRadiusJets.hh"
+#include "EventShards.hh"
+#include "SpectrumTensor.hh"
+#include "AnalysisOptions.hh"
+#include "JetCache.hh"
+#include "StageTimers.hh"
+
+namespace Rivet {
+
+
+  /// @brief Compile-time list of jet radii, in units of 0.1
+  ///
+  /// Histograms for radius R get the suffix "-AK<10R>".
+  template <int... TENTHS>
+  struct RadiusGrid {
+    static const size_t size = sizeof...(TENTHS);
+    static array<int, size> tenths() { return {{TENTHS...}}; }
+    static vector<double> radii() { return {0.1*TENTHS...}; }
+  };
+
+  /// AK2 to AK11, as measured in the CMS radius scan
+  typedef RadiusGrid<2, 3, 4, 5, 6, 7, 8, 9, 10, 11> CMSRadiusGrid;
+
+
+
+  /// @name Jet selection policies for CMS_RAD_Scan
+  ///
+  /// Each gives its name in the OBS analysis option, the histogram
+  /// binning, the |y| acceptance of its jets, how
+  /// many of the hardest accepted jets it needs (maxJets) and the index of
+  /// the first of those it fills (first). Policies which only need the
+  /// first few jets get them by partial selection, without a full sort.
+  //@{
+
+  /// Every selected jet, |y| < 3 plus the forward region
+  struct AllJets {
+    static string suffix() { return ""; }
+    static string option() { return "inclusive"; }
+    static vector<double> yedges() { return {0.0, 0.5, 1.0, 1.5, 2.0, 2.5, 3.0}; }
+    static const bool forward = true;
+    static Cut cut() { return Cuts::absrap < 4.7; }
+    static const size_t maxJets = MultiRadiusJetsByPt::ALL;
+    static const size_t first = 0;
+  };
+
+  /// The leading jet with |y| < 3.5
+  struct LeadingJet {
+    static string suffix() { return "-lead"; }
+    static string option() { return "lead"; }
+    static vector<double> yedges() { return {0.0, 3.5}; }
+    static const bool forward = false;
+    static Cut cut() { return Cuts::absrap < 3.5; }
+    static const size_t maxJets = 1;
+    static const size_t first = 0;
+  };
+
+  /// The second jet with |y| < 3.5
+  struct SecondJet {
+    static string suffix() { return "-2ndlead"; }
+    static string option() { return "2ndlead"; }
+    static vector<double> yedges() { return {0.0, 3.5}; }
+    static const bool forward = false;
+    static Cut cut() { return Cuts::absrap < 3.5; }
+    static const size_t maxJets = 2;
+    static const size_t first = 1;
+  };
+
+  /// The two leading jets
+  struct TwoLeadingJets {
+    static string suffix() { return "-2lead"; }
+    static string option() { return "2lead"; }
+    static vector<double> yedges() { return {0.0, 0.5, 1.0, 1.5, 2.0, 2.5, 3.0}; }
+    static const bool forward = true;
+    static Cut cut() { return Cuts::absrap < 4.7; }
+    static const size_t maxJets = 2;
+    static const size_t first = 0;
+  };
+
+  //@}
+
+
+
+  /// @brief Jet pT spectra at 13 TeV for a grid of AK radii, in one pass
+  ///
+  /// The radii are given by @a GRID and the histogram families by the
+  /// selection policies @a SELECTIONS, all filled from one clustering. With
+  /// more than one family, the histogram names get the policies'
+  /// suffixes; with one, they have none. Analyses with the same grid and
+  /// algorithm share their clustering, and families with the same policy
+  /// share their jet selection.
+  ///
+  /// The RADII and OBS analysis options restrict a run to a subset of the
+  /// grid and of the families, e.g. "CMS_RAD_ALL:RADII=0.4,0.8:OBS=lead,2lead";
+  /// only that subset is clustered, booked and filled. WRITEJETS=<file>
+  /// writes the jets above the lowest family pT cut to a jet cache, and
+  /// READJETS=<file> replays them instead of clustering. RAW=1 stops
+  /// finalize() before the scaling, so that the histograms of several runs
+  /// can be merged and scaled once.
+  ///
+  /// Each family is accumulated in a flat radius x |y| slice x pT bin
+  /// SpectrumTensor, with the reference data binning, and unpacked into
+  /// the booked histograms in finalize().
+  template <typename GRID, typename... SELECTIONS>
+  class CMS_RAD_Scan : public Analysis {
+  public:
+
+    /// Number of radii
+    static const size_t NR = GRID::size;
+
+    /// Number of histogram families
+    static const size_t NSEL = sizeof...(SELECTIONS);
+
+    /// Constructor
+    CMS_RAD_Scan(string name, FastJets::JetAlgName jetalg=FastJets::ANTIKT)
+      : Analysis(name), _jetalg(jetalg)
+    {  }
+
+
+    /// Book histograms and initialize projections:
+    void init() {
+
+      // Radii and families to run, by default all of them
+      _active.clear();
+      vector<double> radii;
+      for (double R : analysisOptionValues(name(), "RADII", GRID::radii())) {
+        const vector<double> grid = GRID::radii();
+        size_t iR = 0;
+        while (iR < NR && !fuzzyEquals(grid[iR], R)) ++iR;
+        if (iR == NR) throw UserError(name() + ": jet radius " + toString(R) + " is not in the radius grid");
+        if (std::find(_active.begin(), _active.end(), iR) != _active.end()) continue;
+        _active.push_back(iR);
+        radii.push_back(grid[iR]);
+      }
+      if (_active.empty()) throw UserError(name() + " needs at least one jet radius");
+      const vector<string> families = analysisOptionList(name(), "OBS", {SELECTIONS::option()...});
+      for (const string& f : families) {
+        if (std::find(_familyNames().begin(), _familyNames().end(), f) == _familyNames().end())
+          throw UserError(name() + ": unknown histogram family '" + f + "'");
+      }
+      for (size_t isel = 0; isel < NSEL; ++isel)
+        _hists[isel].enabled = std::find(families.begin(), families.end(), _familyNames()[isel]) != families.end();
+
+      // Initialize the projections
+      const FinalState fs;
+      declare(fs, "FS");
+      // All active radii from one projection, indexed as in _active
+      MultiRadiusJets jetsAKn(fs, _jetalg, radii);
+      jetsAKn.setWorkerPool(radiusScanPool());
+      jetsAKn.setMinJetPt(_ptmin());
+      declare(jetsAKn, "JetsAKn");
+      // Jet cache writing and replay, on the main thread only
+      const string writejets = analysisOption(name(), "WRITEJETS"), readjets = analysisOption(name(), "READJETS");
+      if (!readjets.empty()) {
+        _replay = make_shared<JetCacheReader>(readjets);
+        if (_replay->radii() != radii) throw UserError(name() + ": jet cache " + readjets + " has different radii");
+        if (_replay->ptMin() > _ptmin()) throw UserError(name() + ": jet cache " + readjets + " has a higher jet pT threshold");
+        _replayJets = make_shared<MultiRadiusClustering>(jetsAKn);
+      }
+      if (!writejets.empty()) _cacheWriter = make_shared<JetCacheWriter>(writejets, radii, false, _ptmin(), sqrtS());
+      _rawOnly = analysisOption(name(), "RAW") == "1";
+      // One jet selection per family, shared with any other analysis of the set
+      size_t isel = 0;
+      using expand = int[];
+      (void) expand{ 0, (_hists[isel++].enabled ? _declareSelection<SELECTIONS>(jetsAKn) : void(), 0)... };
+
+
+      // Book sets of histograms, binned in absolute rapidity
+      isel = 0;
+      (void) expand{ 0, (_hists[isel].enabled ? _book<SELECTIONS>(_hists[isel], _spectra[isel]) : void(), ++isel, 0)... };
+
+
+      // Event-parallel running, if enabled: each worker clusters the events
+      // it is given and fills its own empty copy of the spectra
+      _shards.init(_replay || _cacheWriter ? shared_ptr<WorkerPool>() : eventParallelPool(),
+                   [&] {
+                     Shard s = { jetsAKn, _emptyClone(_spectra) };
+                     s.jets.setWorkerPool(shared_ptr<WorkerPool>());
+                     return s;
+                   },
+                   [this](const Record& r, Shard& s) {
+                     RIVET_STAGE_EVENT_PART(_timers);
+                     s.jets.calc(r.particles);
+                     size_t isel = 0;
+                     using expand = int[];
+                     (void) expand{ 0, (_hists[isel].enabled ? _fillFamily<SELECTIONS>(s.spectra[isel], _select<SELECTIONS>(s.jets), r.weight) : void(), ++isel, 0)... };
+                   });
+
+    }
+
+
+    /// Per-event analysis
+    void analyze(const Event &event) {
+
+      const double weight = event.weight();
+      using expand = int[];
+      RIVET_STAGE_EVENT(_timers);
+
+      // Replay from the jet cache, which also records which events were vetoed
+      if (_replay) {
+        if (!_replay->next(_replayEvent)) throw UserError(name() + ": the jet cache has fewer events than the run");
+        if (!_replayEvent.hasJets) vetoEvent;
+        _replayJets->load(_replayEvent);
+        size_t isel = 0;
+        (void) expand{ 0, (_hists[isel].enabled ? _fillFamily<SELECTIONS>(_spectra[isel], _select<SELECTIONS>(*_replayJets), _replayEvent.weight) : void(), ++isel, 0)... };
+        return;
+      }
+      if (_cacheWriter) _cacheWriter->beginEvent(weight);
+
+      // Event-parallel: the workers cluster, so the inputs are selected and
+      // checked against the pT bound here, without applying the projection
+      if (_shards.enabled()) {
+        const MultiRadiusJets& jetsAKn = getProjection<MultiRadiusJets>("JetsAKn");
+        Particles inputs;
+        {
+          RIVET_STAGE_TIMER("jet inputs and pT bound");
+          inputs = jetsAKn.selectInputs(apply<FinalState>(event, "FS").particles());
+          if (jetsAKn.maxJetPtBound(inputs) < _ptmin()) vetoEvent;
+        }
+        _shards.add(Record{ weight, detached(inputs) });
+        return;
+      }
+
+      // The projection, shared by the analyses of the set, skips the
+      // clustering when no jet at any radius can reach the pT cut
+      const MultiRadiusJets& jetsAKn = apply<MultiRadiusJets>(event, "JetsAKn");
+      if (jetsAKn.belowMinJetPt()) vetoEvent;
+      if (_cacheWriter) _cacheWriter->write(Particles(), jetsAKn);
+      size_t isel = 0;
+      (void) expand{ 0, (_hists[isel].enabled ? _fillFamily<SELECTIONS>(_spectra[isel], apply<MultiRadiusJetsByPt>(event, "SelectedJetsAKn" + SELECTIONS::suffix()).jetsByRadius(), weight) : void(), ++isel, 0)... };
+
+    }
+
+
+    // Finalize
+    void finalize() {
+      // Fold in the workers' spectra, then unpack into the histograms before any scaling
+      _shards.merge([&](Shard& s) { _add(_spectra, s.spectra); });
+      if (_cacheWriter) _cacheWriter->finish(crossSection());
+      for (const string& line : _timers.report(getProjection<MultiRadiusJets>("JetsAKn").radii())) MSG_INFO(line);
+      for (size_t isel = 0; isel < NSEL; ++isel) {
+        FamilyHists& fh = _hists[isel];
+        const FamilySpectra& fs = _spectra[isel];
+        if (!fh.enabled) continue;
+        for (size_t k = 0; k < _active.size(); ++k) {
+          const size_t iR = _active[k];
+          for (size_t iy = 0; iy < fs.central.numSlices(); ++iy)
+            fs.central.unpack(k, iy, *fh.sigma[iR].getHistograms()[iy]);
+          if (fh.forward) fs.forward.unpack(k, 0, *fh.sigmaForward[iR]);
+        }
+      }
+      if (_rawOnly) return;
+
+      /// @todo What is the cross-section unit?
+      for (FamilyHists& fh : _hists) {
+        if (!fh.enabled) continue;
+        for (size_t iR : _active) {
+          fh.sigma[iR].scale(crossSection()/sumOfWeights()/2.0, this);
+          if (fh.forward) scale(fh.sigmaForward[iR], crossSection()/sumOfWeights()/3.0);
+        }
+      }
+
+    }
+
+
+  protected:
+
+    /// Histograms of one family for all radii, booked only for the active ones
+    struct FamilyHists {
+      bool enabled;
+      vector<double> yedges;
+      bool forward;
+      array<BinnedHistogram<double>, NR> sigma;
+      array<Histo1DPtr, NR> sigmaForward;
+    };
+
+    /// Booked histograms of every family, in SELECTIONS order
+    typedef array<FamilyHists, NSEL> Hists;
+
+    /// Accumulators of one family for the active radii, indexed as in _active
+    struct FamilySpectra {
+      SpectrumTensor central, forward;
+    };
+
+    /// Accumulators of every family, in SELECTIONS order: the main ones, or one worker's copy
+    typedef array<FamilySpectra, NSEL> Spectra;
+
+    /// Clustering inputs copied out of one event
+    struct Record {
+      double weight;
+      Particles particles;
+    };
+
+    /// One worker's clustering and spectra
+    struct Shard {
+      MultiRadiusClustering jets;
+      Spectra spectra;
+    };
+
+
+    /// Lowest jet pT in any family
+    static double _ptmin() { return 114*GeV; }
+
+    /// Jet selection for a family with |y| acceptance @a ycut
+    static Cut _jetcut(const Cut& ycut) {
+      return Cuts::ptIn(_ptmin(), 2200.0*GeV) && ycut;
+    }
+
+    /// The jets of family @a SEL at every radius of @a mrj, for use away from the projection system
+    template <typename SEL>
+    static vector<Jets> _select(const MultiRadiusClustering& mrj) {
+      return MultiRadiusJetsByPt::select(mrj, _jetcut(SEL::cut()), SEL::maxJets);
+    }
+
+
+    /// OBS option names of the families, in SELECTIONS order
+    static const vector<string>& _familyNames() {
+      static const vector<string> names = {SELECTIONS::option()...};
+      return names;
+    }
+
+    /// Declare the jet selection of family @a SEL from @a jetsAKn
+    template <typename SEL>
+    void _declareSelection(const MultiRadiusJets& jetsAKn) {
+      declare(MultiRadiusJetsByPt(jetsAKn, _jetcut(SEL::cut()), SEL::maxJets), "SelectedJetsAKn" + SEL::suffix());
+    }
+
+
+    /// Book the histograms of family @a SEL at the active radii into @a fh, and their accumulators into @a fs
+    template <typename SEL>
+    void _book(FamilyHists& fh, FamilySpectra& fs) {
+      const string fsuff = NSEL > 1 ? SEL::suffix() : "";
+      fh.yedges = SEL::yedges();
+      fh.forward = SEL::forward;
+      for (size_t iR : _active) {
+        const string suff = "-AK" + toString(GRID::tenths()[iR]) + fsuff;
+        for (size_t iy = 0; iy+1 < fh.yedges.size(); ++iy)
+          fh.sigma[iR].addHistogram(fh.yedges[iy], fh.yedges[iy+1], bookHisto1D("d0" + toString(iy+1) + "-x01-y01" + suff, refData(iy+1,1,1)));
+        if (fh.forward) fh.sigmaForward[iR] = bookHisto1D("d07-x01-y01" + suff, refData(7,1,1));
+      }
+
+      // The pT binning of each slice is the same at every radius
+      vector< vector<double> > ptedges;
+      for (Histo1DPtr h : fh.sigma[_active[0]].getHistograms()) ptedges.push_back(SpectrumTensor::edgesOf(*h));
+      fs.central = SpectrumTensor(_active.size(), fh.yedges, ptedges);
+      if (fh.forward)
+        fs.forward = SpectrumTensor(_active.size(), {3.2, 4.7}, { SpectrumTensor::edgesOf(*fh.sigmaForward[_active[0]]) });
+    }
+
+
+    /// Fill @a fs with the pT-ordered jets of family @a SEL at every active radius, @a jetsByR
+    template <typename SEL>
+    static void _fillFamily(FamilySpectra& fs, const vector<Jets>& jetsByR, double weight) {
+      for (size_t iR = 0; iR < jetsByR.size(); ++iR) {
+        RIVET_STAGE_TIMER_R("fills, " + SEL::option(), iR);
+        const Jets& jets = jetsByR[iR];
+        for (size_t i = SEL::first; i < jets.size(); ++i) {
+          fs.central.fill(iR, jets[i].absrap(), jets[i].pT(), weight);
+          if (SEL::forward) fs.forward.fill(iR, jets[i].absrap(), jets[i].pT(), weight);
+        }
+      }
+    }
+
+
+    /// Empty copy of @a spectra with the same binning
+    static Spectra _emptyClone(const Spectra& spectra) {
+      Spectra rtn = spectra;
+      for (FamilySpectra& fs : rtn) {
+        fs.central.reset();
+        fs.forward.reset();
+      }
+      return rtn;
+    }
+
+    /// Add the contents of @a from to @a to
+    static void _add(Spectra& to, const Spectra& from) {
+      for (size_t isel = 0; isel < NSEL; ++isel) {
+        to[isel].central += from[isel].central;
+        to[isel].forward += from[isel].forward;
+      }
+    }
+
+
+    /// @name Histograms
+    //@{
+    Hists _hists;
+    Spectra _spectra;
+    //@}
+
+    /// Grid indices of the radii run, in MultiRadiusJets order
+    vector<size_t> _active;
+
+    /// Whether finalize() stops before the scaling
+    bool _rawOnly;
+
+    /// @name Jet cache writing and replay
+    //@{
+    shared_ptr<JetCacheWriter> _cacheWriter;
+    shared_ptr<JetCacheReader> _replay;
+    shared_ptr<MultiRadiusClustering> _replayJets;
+    CachedEvent _replayEvent;
+    //@}
+
+    /// Per-worker state for event-parallel running
+    EventShards<Record, Shard> _shards;
+
+    /// Stage timings, if compiled in
+    StageTimers _timers;
+
+    /// Jet algorithm used for every radius
+    FastJets::JetAlgName _jetalg;
+
+  };
+
+
+
+  /// Every CMS_RAD family, from one pass over the AK2 to AK11 jets
+  struct CMS_RAD_ALL : public CMS_RAD_Scan<CMSRadiusGrid, AllJets, LeadingJet, SecondJet, TwoLeadingJets> {
+    CMS_RAD_ALL() : CMS_RAD_Scan("CMS_RAD_ALL") {  }
+  };
+
+
+}
+
+#endif
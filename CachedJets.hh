@@ -0,0 +1,46 @@
+// -*- C++ -*-
+#ifndef RIVET_CachedJets_HH
+#define RIVET_CachedJets_HH
+
+#include "Rivet/Particle.hh"
+#include <cstdint>
+#include <vector>
+
+namespace Rivet {
+
+
+  /// @brief Jets of one radius in one cached event, as columns
+  ///
+  /// Jet i is entry i of the jet columns. If constituents were cached, its
+  /// constituents are entries offsets[i] to offsets[i+1] of the constituent
+  /// columns; otherwise offsets is empty.
+  struct CachedJets {
+    std::vector<double> pt, y, phi, m;
+    std::vector<uint32_t> offsets;
+    std::vector<double> cpt, ceta, cphi;
+
+    /// Number of jets
+    size_t size() const { return pt.size(); }
+
+    /// Whether the constituents were cached
+    bool hasConstituents() const { return !offsets.empty(); }
+  };
+
+
+  /// @brief One event of a jet cache
+  ///
+  /// Events vetoed before clustering keep their weight, so that a replay
+  /// sees the same sum of weights, but have no jets.
+  struct CachedEvent {
+    double weight;
+    bool hasJets;
+    /// Non-jet objects the analysis needs back, e.g. the vector boson
+    Particles extras;
+    /// Jets at each radius, in the cache's radius order
+    std::vector<CachedJets> jets;
+  };
+
+
+}
+
+#endif
@@ -0,0 +1,32 @@
+// -*- C++ -*-
+#ifndef RIVET_ConstituentView_HH
+#define RIVET_ConstituentView_HH
+
+#include <cstddef>
+
+namespace Rivet {
+
+
+  /// @brief Read-only view of the kinematics of one jet's constituents
+  ///
+  /// The kinematics are event-level arrays, one entry per clustered
+  /// particle, owned by the clustering; the constituents are given by their
+  /// indices into them. Nothing is copied, and the view is only valid until
+  /// the next event is clustered or the index buffer is reused.
+  struct ConstituentView {
+
+    /// Number of constituents
+    size_t size;
+
+    /// Indices of the constituents in the kinematics arrays
+    const int* index;
+
+    /// pT, pseudorapidity and phi (in [0, 2pi)) of every clustered particle
+    const double *pt, *eta, *phi;
+
+  };
+
+
+}
+
+#endif
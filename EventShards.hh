@@ -0,0 +1,120 @@
+// -*- C++ -*-
+#ifndef RIVET_EventShards_HH
+#define RIVET_EventShards_HH
+
+#include "Rivet/Particle.hh"
+#include "WorkerPool.hh"
+
+namespace Rivet {
+
+
+  /// @name Event-parallel running
+  //@{
+
+  /// @brief Process-wide pool for event-parallel running, or null if not enabled
+  ///
+  /// Event-parallel running is opt-in: set RIVET_EVENT_THREADS to the number
+  /// of threads to use (including the main one) to enable it.
+  inline shared_ptr<WorkerPool> eventParallelPool() {
+    static const shared_ptr<WorkerPool> pool = [] {
+      const char* env = std::getenv("RIVET_EVENT_THREADS");
+      const long n = env ? std::atol(env) : 0;
+      return n > 1 ? make_shared<WorkerPool>(n) : shared_ptr<WorkerPool>();
+    }();
+    return pool;
+  }
+
+
+  /// Analysis object with the same type, binning and path as @a ao, but no entries
+  template <typename T>
+  inline shared_ptr<T> emptyClone(const shared_ptr<T>& ao) {
+    shared_ptr<T> rtn = make_shared<T>(*ao);
+    rtn->reset();
+    return rtn;
+  }
+
+
+  /// @brief Copies of @a particles with no link to the generator record
+  ///
+  /// For particles which have to outlive the current event.
+  inline Particles detached(const Particles& particles) {
+    Particles rtn;
+    rtn.reserve(particles.size());
+    for (const Particle& p : particles) rtn.push_back(Particle(p.pid(), p.momentum()));
+    return rtn;
+  }
+
+
+  /// @brief Batched processing of events on per-thread shards of analysis state
+  ///
+  /// The analysis copies what it needs out of each event into a Record
+  /// (nothing may point into the generator record) and hands it to add().
+  /// Records are processed in batches on the pool: the n-th record of the run
+  /// always goes to shard n % nshards, and each shard sees its records in
+  /// run order. The shards are combined with merge(), always in shard order,
+  /// so the result is reproducible for a fixed number of threads.
+  template <typename Record, typename Shard>
+  class EventShards {
+  public:
+
+    typedef std::function<void(const Record&, Shard&)> Processor;
+
+    /// Inactive: enabled() is false until init() is called with a pool
+    EventShards() : _nseen(0), _batchsize(0) {  }
+
+    /// Make one shard per pool thread with @a mkshard, to be filled by @a process
+    void init(const shared_ptr<WorkerPool>& pool, const std::function<Shard()>& mkshard,
+              const Processor& process, size_t batchsize=256) {
+      _pool = pool;
+      if (!_pool) return;
+      _process = process;
+      _batchsize = batchsize * _pool->size();
+      _shards.clear();
+      for (size_t i = 0; i < _pool->size(); ++i) _shards.push_back(mkshard());
+      _batch.reserve(_batchsize);
+    }
+
+    /// Whether events are being processed in parallel
+    bool enabled() const { return bool(_pool); }
+
+    /// Queue one event, processing the batch if it is full
+    void add(Record&& r) {
+      _batch.push_back(std::move(r));
+      if (_batch.size() >= _batchsize) flush();
+    }
+
+    /// Process all queued events
+    void flush() {
+      if (_batch.empty()) return;
+      const size_t nshards = _shards.size();
+      _pool->run(nshards, [&](size_t ishard) {
+          for (size_t i = (ishard + nshards - _nseen % nshards) % nshards; i < _batch.size(); i += nshards)
+            _process(_batch[i], _shards[ishard]);
+        });
+      _nseen += _batch.size();
+      _batch.clear();
+    }
+
+    /// Process all queued events, then call @a fn on every shard in order
+    void merge(const std::function<void(Shard&)>& fn) {
+      flush();
+      for (Shard& s : _shards) fn(s);
+    }
+
+
+  private:
+
+    shared_ptr<WorkerPool> _pool;
+    Processor _process;
+    vector<Shard> _shards;
+    vector<Record> _batch;
+    size_t _nseen, _batchsize;
+
+  };
+
+  //@}
+
+
+}
+
+#endif
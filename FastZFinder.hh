@@ -0,0 +1,201 @@
+// -*- C++ -*-
+#ifndef RIVET_FastZFinder_HH
+#define RIVET_FastZFinder_HH
+
+#include "Rivet/Projections/FinalState.hh"
+#include "Rivet/Projections/VetoedFinalState.hh"
+#include "Rivet/Projections/ZFinder.hh"
+#include "StageTimers.hh"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace Rivet {
+
+
+  /// @brief ZFinder with grid-based photon dressing and a charge-split pairing
+  ///
+  /// Finds the same Z as a ZFinder with the same arguments: bare leptons of
+  /// the given flavour are dressed with the photons within dRmax (each
+  /// photon going to its closest lepton), the dressed leptons passing the
+  /// cut are paired with opposite-flavour ones, and the pair in the mass
+  /// window closest to the target mass makes the Z.
+  ///
+  /// ZFinder checks every photon's ancestry and its distance to every
+  /// lepton. Here the photons are put in (eta, phi) cells of side at least
+  /// dRmax, each lepton only looks at the 3x3 cells around it, and only
+  /// the photons actually in a cone have their ancestry checked. With
+  /// dRmax = 0 no photon can be clustered and none are looked at. The
+  /// pairing only tries lepton-antilepton pairs.
+  class FastZFinder : public FinalState {
+  public:
+
+    /// Constructor with the ZFinder arguments
+    FastZFinder(const FinalState& inputfs, const Cut& fsCut, PdgId pid, double minmass, double maxmass,
+                double dRmax=0.1, ZFinder::ClusterPhotons clusterPhotons=ZFinder::CLUSTERNODECAY,
+                ZFinder::PhotonTracking trackPhotons=ZFinder::NOTRACK, double masstarget=91.2*GeV)
+      : _cut(fsCut), _pid(abs(pid)), _minmass(minmass), _maxmass(maxmass), _dRmax(dRmax),
+        _clusterPhotons(clusterPhotons), _trackPhotons(trackPhotons), _masstarget(masstarget)
+    {
+      setName("FastZFinder");
+      declare(inputfs, "FS");
+      // As in ZFinder, the veto is on a copy made before RFS is declared
+      VetoedFinalState remainingFS(inputfs);
+      remainingFS.addVetoOnThisFinalState(*this);
+      declare(remainingFS, "RFS");
+    }
+
+    /// Clone on the heap
+    DEFAULT_RIVET_PROJ_CLONE(FastZFinder);
+
+
+    /// The Z, if one was found
+    const Particles& bosons() const { return _bosons; }
+
+    /// The dressed leptons of the Z, positive charge first
+    const Particles& constituentLeptons() const { return _leptons; }
+
+    /// The input final state without the Z's bare leptons (and, when tracking, their photons)
+    const VetoedFinalState& remainingFinalState() const { return getProjection<VetoedFinalState>("RFS"); }
+
+
+  protected:
+
+    /// Dress, select and pair the leptons
+    void project(const Event& e) {
+      clear();
+      _bosons.clear();
+      _leptons.clear();
+      const Particles& fsparticles = applyProjection<FinalState>(e, "FS").particles();
+      RIVET_STAGE_TIMER("Z finder");
+
+      // Bare leptons and candidate photons
+      vector<Lepton> leptons;
+      Particles photons;
+      for (const Particle& p : fsparticles) {
+        if (p.abspid() == _pid) leptons.push_back(Lepton{ p, p.momentum(), {} });
+        else if (p.pid() == PID::PHOTON) photons.push_back(p);
+      }
+      if (leptons.size() < 2) return;
+      if (_clusterPhotons != ZFinder::NOCLUSTER && _dRmax > 0 && !photons.empty()) _dress(leptons, photons);
+
+      // Opposite-flavour pairs of dressed leptons passing the cut, in ZFinder's order
+      vector<const Lepton*> negs, poss;
+      for (const Lepton& l : leptons) {
+        const Particle dressed(l.bare.pid(), l.p);
+        if (!_cut->accept(dressed)) continue;
+        (l.bare.pid() == _pid ? negs : poss).push_back(&l);
+      }
+      const Lepton *best1 = 0, *best2 = 0;
+      double bestdiff = DBL_MAX;
+      for (const Lepton* l1 : negs) {
+        for (const Lepton* l2 : poss) {
+          const double m2 = (l1->p + l2->p).mass2();
+          if (m2 < 0 || m2 < sqr(_minmass) || m2 > sqr(_maxmass)) continue;
+          const double diff = fabs(sqrt(m2) - _masstarget);
+          if (diff < bestdiff) {
+            bestdiff = diff;
+            best1 = l1;
+            best2 = l2;
+          }
+        }
+      }
+      if (!best1) return;
+
+      // Positive charge first, as in ZFinder
+      if (PID::threeCharge(best1->bare.pid()) < PID::threeCharge(best2->bare.pid())) std::swap(best1, best2);
+      _bosons.push_back(Particle(PID::ZBOSON, best1->p + best2->p));
+      for (const Lepton* l : { best1, best2 }) {
+        _leptons.push_back(Particle(l->bare.pid(), l->p));
+        _theParticles.push_back(l->bare);
+        if (_trackPhotons == ZFinder::TRACK)
+          for (size_t ip : l->photons) _theParticles.push_back(photons[ip]);
+      }
+    }
+
+    /// Compare projections
+    int compare(const Projection& p) const {
+      const FastZFinder& other = dynamic_cast<const FastZFinder&>(p);
+      const int pcmp = mkNamedPCmp(other, "FS") ||
+        cmp(_pid, other._pid) || cmp(_minmass, other._minmass) || cmp(_maxmass, other._maxmass) ||
+        cmp(_dRmax, other._dRmax) || cmp(_clusterPhotons, other._clusterPhotons) ||
+        cmp(_trackPhotons, other._trackPhotons) || cmp(_masstarget, other._masstarget);
+      if (pcmp != EQUIVALENT) return pcmp;
+      return _cut == other._cut ? EQUIVALENT : UNDEFINED;
+    }
+
+
+  private:
+
+    /// A bare lepton, its dressed momentum and the indices of its photons
+    struct Lepton {
+      Particle bare;
+      FourMomentum p;
+      vector<size_t> photons;
+    };
+
+    /// Give each photon within dRmax of a lepton to the closest one, as ZFinder does
+    void _dress(vector<Lepton>& leptons, const Particles& photons) const {
+      // Cells of side >= dRmax, so a cone only reaches the neighbouring cells
+      const size_t nphi = max(size_t(1), size_t(2*M_PI/_dRmax));
+      const double dphi = 2*M_PI/nphi;
+      auto cellOf = [&](const FourMomentum& p) {
+        const long ieta = long(floor(p.eta()/_dRmax));
+        const long iphi = min(long(nphi) - 1, long(p.phi(ZERO_2PI)/dphi));
+        return make_pair(ieta, iphi);
+      };
+      vector< pair<pair<long, long>, size_t> > cells;
+      cells.reserve(photons.size());
+      for (size_t ip = 0; ip < photons.size(); ++ip) cells.push_back(make_pair(cellOf(photons[ip].momentum()), ip));
+      std::sort(cells.begin(), cells.end());
+
+      // Closest lepton to each photon in a cone, ties to the first lepton
+      vector<double> dRmin(photons.size(), _dRmax);
+      vector<int> owner(photons.size(), -1);
+      for (size_t il = 0; il < leptons.size(); ++il) {
+        const FourMomentum& pl = leptons[il].bare.momentum();
+        const pair<long, long> c = cellOf(pl);
+        vector<long> iphis;
+        for (long d = -1; d <= 1; ++d) {
+          const long iphi = (c.second + d + long(nphi)) % long(nphi);
+          if (std::find(iphis.begin(), iphis.end(), iphi) == iphis.end()) iphis.push_back(iphi);
+        }
+        for (long ieta = c.first - 1; ieta <= c.first + 1; ++ieta) {
+          for (long iphi : iphis) {
+            auto it = std::lower_bound(cells.begin(), cells.end(), make_pair(make_pair(ieta, iphi), size_t(0)));
+            for (; it != cells.end() && it->first == make_pair(ieta, iphi); ++it) {
+              const double dR = deltaR(pl, photons[it->second].momentum());
+              if (dR < dRmin[it->second]) {
+                dRmin[it->second] = dR;
+                owner[it->second] = il;
+              }
+            }
+          }
+        }
+      }
+
+      // Add the photons in input order, skipping decay photons unless clustering all
+      for (size_t ip = 0; ip < photons.size(); ++ip) {
+        if (owner[ip] < 0) continue;
+        if (_clusterPhotons != ZFinder::CLUSTERALL && photons[ip].fromDecay()) continue;
+        leptons[owner[ip]].p += photons[ip].momentum();
+        leptons[owner[ip]].photons.push_back(ip);
+      }
+    }
+
+
+    Cut _cut;
+    PdgId _pid;
+    double _minmass, _maxmass, _dRmax;
+    ZFinder::ClusterPhotons _clusterPhotons;
+    ZFinder::PhotonTracking _trackPhotons;
+    double _masstarget;
+
+    Particles _bosons, _leptons;
+
+  };
+
+
+}
+
+#endif
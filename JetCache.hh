@@ -0,0 +1,259 @@
+// -*- C++ -*-
+#ifndef RIVET_JetCache_HH
+#define RIVET_JetCache_HH
+
+#include "MultiRadiusJets.hh"
+#include "CachedJets.hh"
+#include <fstream>
+
+namespace Rivet {
+
+
+  /// @name Jet cache files
+  ///
+  /// A jet cache holds the clustered jets of a run, so that later runs with
+  /// other binnings or selections can replay them instead of reading and
+  /// clustering the events again. The file is binary, in native byte order:
+  ///
+  /// - a header: the magic "RIVJETC1", the number of radii and the radii,
+  ///   whether constituents are kept, the jet pT threshold and sqrt(s);
+  /// - one record per event: 'V' and the weight for an event vetoed before
+  ///   clustering, or 'E', the weight, the extra particles as pid, pT, y,
+  ///   phi and mass columns, and for each radius the number of jets, the
+  ///   jet pT, y, phi and mass columns and, if kept, the constituent
+  ///   offsets and constituent pT, eta and phi columns;
+  /// - a trailer: 'X' and the cross-section.
+  ///
+  /// Jets are written in decreasing pT order.
+  //@{
+
+
+  /// Writes the jets of each event to a jet cache
+  class JetCacheWriter {
+  public:
+
+    /// Open @a path and write the header
+    JetCacheWriter(const string& path, const vector<double>& radii, bool constituents, double ptmin, double sqrtS)
+      : _out(path.c_str(), std::ios::binary), _nradii(radii.size()), _constituents(constituents), _ptmin(ptmin),
+        _pending(false), _weight(0)
+    {
+      if (!_out) throw UserError("Could not open jet cache " + path + " for writing");
+      _out.write("RIVJETC1", 8);
+      _write(uint32_t(_nradii));
+      _out.write(reinterpret_cast<const char*>(radii.data()), radii.size()*sizeof(double));
+      _write(uint8_t(_constituents));
+      _write(_ptmin);
+      _write(sqrtS);
+    }
+
+    /// Start an event of weight @a weight, which counts as vetoed unless its jets are written
+    void beginEvent(double weight) {
+      _flushPending();
+      _weight = weight;
+      _pending = true;
+    }
+
+    /// Write the jets of the current event at or above the pT threshold, from @a mrj, with the particles @a extras
+    void write(const Particles& extras, const MultiRadiusClustering& mrj) {
+      if (mrj.numRadii() != _nradii) throw UserError("Jet cache written with the wrong number of radii");
+      _pending = false;
+      _write(uint8_t('E'));
+      _write(_weight);
+
+      vector<int32_t> pid;
+      vector<double> pt, y, phi, m;
+      for (const Particle& p : extras) {
+        pid.push_back(p.pid());
+        pt.push_back(p.pT());
+        y.push_back(p.rapidity());
+        phi.push_back(p.phi());
+        m.push_back(p.mass());
+      }
+      _write(uint32_t(extras.size()));
+      _writeColumns(pid);
+      _writeColumns(pt, y, phi, m);
+
+      vector<int> buffer;
+      for (size_t iR = 0; iR < _nradii; ++iR) {
+        const Jets jets = mrj.lightJetsByPt(iR, Cuts::pT >= _ptmin);
+        pt.clear(); y.clear(); phi.clear(); m.clear();
+        for (const Jet& j : jets) {
+          pt.push_back(j.pT());
+          y.push_back(j.rapidity());
+          phi.push_back(j.phi());
+          m.push_back(j.mass());
+        }
+        _write(uint32_t(jets.size()));
+        _writeColumns(pt, y, phi, m);
+        if (!_constituents) continue;
+
+        vector<uint32_t> offsets(1, 0);
+        vector<double> cpt, ceta, cphi;
+        for (const Jet& j : jets) {
+          const ConstituentView c = mrj.constituents(iR, j, buffer);
+          for (size_t k = 0; k < c.size; ++k) {
+            cpt.push_back(c.pt[c.index[k]]);
+            ceta.push_back(c.eta[c.index[k]]);
+            cphi.push_back(c.phi[c.index[k]]);
+          }
+          offsets.push_back(cpt.size());
+        }
+        _writeColumns(offsets);
+        _writeColumns(cpt, ceta, cphi);
+      }
+    }
+
+    /// Write the last event and the trailer with the cross-section @a xs
+    void finish(double xs) {
+      _flushPending();
+      _write(uint8_t('X'));
+      _write(xs);
+      _out.close();
+    }
+
+
+  private:
+
+    /// Write the current event as vetoed if its jets were not written
+    void _flushPending() {
+      if (!_pending) return;
+      _write(uint8_t('V'));
+      _write(_weight);
+      _pending = false;
+    }
+
+    template <typename T>
+    void _write(const T& x) {
+      _out.write(reinterpret_cast<const char*>(&x), sizeof(T));
+    }
+
+    template <typename T>
+    void _writeColumns(const vector<T>& c) {
+      _out.write(reinterpret_cast<const char*>(c.data()), c.size()*sizeof(T));
+    }
+
+    template <typename T, typename... MORE>
+    void _writeColumns(const vector<T>& c, const MORE&... more) {
+      _writeColumns(c);
+      _writeColumns(more...);
+    }
+
+    std::ofstream _out;
+    size_t _nradii;
+    bool _constituents;
+    double _ptmin;
+    bool _pending;
+    double _weight;
+
+  };
+
+
+
+  /// Reads the events of a jet cache in order
+  class JetCacheReader {
+  public:
+
+    /// Open @a path and read the header
+    explicit JetCacheReader(const string& path)
+      : _path(path), _in(path.c_str(), std::ios::binary), _xs(-1)
+    {
+      char magic[8];
+      if (!_in.read(magic, 8) || string(magic, 8) != "RIVJETC1")
+        throw UserError("Could not read " + path + " as a jet cache");
+      _radii.resize(_read<uint32_t>());
+      _readColumns(_radii);
+      _constituents = _read<uint8_t>();
+      _ptmin = _read<double>();
+      _sqrtS = _read<double>();
+    }
+
+    /// @name Header
+    //@{
+    const vector<double>& radii() const { return _radii; }
+    bool hasConstituents() const { return _constituents; }
+    double ptMin() const { return _ptmin; }
+    double sqrtS() const { return _sqrtS; }
+    //@}
+
+    /// Cross-section from the trailer, once next() has reached it
+    double crossSection() const {
+      if (_xs < 0) throw UserError("Jet cache " + _path + " has not been read up to its cross-section");
+      return _xs;
+    }
+
+    /// Read the next event into @a ev, or return false at the end of the file
+    bool next(CachedEvent& ev) {
+      if (_xs >= 0) return false;
+      const uint8_t tag = _read<uint8_t>();
+      if (tag == 'X') {
+        _xs = _read<double>();
+        return false;
+      }
+      if (tag != 'V' && tag != 'E') throw UserError("Corrupt jet cache " + _path);
+      ev.weight = _read<double>();
+      ev.hasJets = tag == 'E';
+      ev.extras.clear();
+      ev.jets.clear();
+      if (!ev.hasJets) return true;
+
+      const size_t nextras = _read<uint32_t>();
+      vector<int32_t> pid(nextras);
+      vector<double> pt(nextras), y(nextras), phi(nextras), m(nextras);
+      _readColumns(pid, pt, y, phi, m);
+      for (size_t i = 0; i < nextras; ++i) {
+        const double mt = std::sqrt(pt[i]*pt[i] + m[i]*m[i]);
+        ev.extras.push_back(Particle(pid[i], FourMomentum(mt*std::cosh(y[i]), pt[i]*std::cos(phi[i]),
+                                                          pt[i]*std::sin(phi[i]), mt*std::sinh(y[i]))));
+      }
+
+      ev.jets.resize(_radii.size());
+      for (CachedJets& cj : ev.jets) {
+        const size_t njets = _read<uint32_t>();
+        cj.pt.resize(njets); cj.y.resize(njets); cj.phi.resize(njets); cj.m.resize(njets);
+        _readColumns(cj.pt, cj.y, cj.phi, cj.m);
+        cj.offsets.clear();
+        if (!_constituents) continue;
+        cj.offsets.resize(njets+1);
+        _readColumns(cj.offsets);
+        const size_t ncons = cj.offsets.back();
+        cj.cpt.resize(ncons); cj.ceta.resize(ncons); cj.cphi.resize(ncons);
+        _readColumns(cj.cpt, cj.ceta, cj.cphi);
+      }
+      return true;
+    }
+
+
+  private:
+
+    template <typename T>
+    T _read() {
+      T x;
+      if (!_in.read(reinterpret_cast<char*>(&x), sizeof(T))) throw UserError("Truncated jet cache " + _path);
+      return x;
+    }
+
+    template <typename T>
+    void _readColumns(vector<T>& c) {
+      if (!_in.read(reinterpret_cast<char*>(c.data()), c.size()*sizeof(T))) throw UserError("Truncated jet cache " + _path);
+    }
+
+    template <typename T, typename... MORE>
+    void _readColumns(vector<T>& c, MORE&... more) {
+      _readColumns(c);
+      _readColumns(more...);
+    }
+
+    string _path;
+    std::ifstream _in;
+    vector<double> _radii;
+    bool _constituents;
+    double _ptmin, _sqrtS, _xs;
+
+  };
+
+  //@}
+
+
+}
+
+#endif
@@ -2,7 +2,14 @@
 #include "Rivet/Analysis.hh"
 #include "Rivet/Projections/FinalState.hh"
 #include "Rivet/Projections/FastJets.hh"
-#include <tuple> //< remove from R2.6 onward
+#include "MultiRadiusJets.hh"
+#include "WorkerPool.hh"
+#include "EventShards.hh"
+#include "Angularities.hh"
+#include "AnalysisOptions.hh"
+#include "PIDIndex.hh"
+#include "JetCache.hh"
+#include "StageTimers.hh"
 
 // NOTES FROM JOEY
 // pTjet > 30 GeV/c; upper limit 500 GeV/c for Higgs and 1 TeV for Z
@@ -35,214 +42,655 @@ namespace Rivet {
     double JET_RADII[6] = {0.3, 0.4, 0.5, 0.6, 0.7, 1.0};
 
     // Constructor
-    DEFAULT_RIVET_ANALYSIS_CTOR(LH2017_ZHJETS);
+    LH2017_ZHJETS(string name="LH2017_ZHJETS")
+      : Analysis(name), _jetalg(FastJets::ANTIKT)
+    {  }
 
 
     // Book histograms and initialize projections:
     void init() {
       const FinalState fs;
-      declare(fs, "FS");
+      _fsproj = &declare(fs, "FS");
+      _pidindex = &declare(PIDIndex(), "PIDIndex");
+
+      // Radii and observable groups to run, by default all of them. The
+      // histogram suffixes round radii to 0.1, so radii must differ by that:
+      // e.g. RIVET_ANALYSIS_OPTIONS="LH2017_ZHJETS:RADII=0.4,0.7:OBS=spectra,angularities"
+      _radii = analysisOptionValues(name(), "RADII", vector<double>(std::begin(JET_RADII), std::end(JET_RADII)));
+      if (_radii.empty()) throw UserError(name() + " needs at least one jet radius");
+      for (size_t i = 0; i < _radii.size(); ++i) {
+        if (_radii[i] <= 0) throw UserError(name() + ": jet radius " + toString(_radii[i]) + " is not positive");
+        for (size_t j = 0; j < i; ++j)
+          if (_radiusSuffix(_radii[j]) == _radiusSuffix(_radii[i]))
+            throw UserError(name() + ": jet radii " + toString(_radii[j]) + " and " + toString(_radii[i]) +
+                            " would both book histograms " + _radiusSuffix(_radii[i]));
+      }
+      _doMultiplicity = _doSpectra = _doAngularities = false;
+      for (const string& obs : analysisOptionList(name(), "OBS", {"multiplicity", "spectra", "angularities"})) {
+        if (obs == "multiplicity") _doMultiplicity = true;
+        else if (obs == "spectra") _doSpectra = true;
+        else if (obs == "angularities") _doAngularities = true;
+        else throw UserError(name() + ": unknown observable group '" + obs + "'; use multiplicity, spectra or angularities");
+      }
+
+      // Generalised angularities beyond the standard five, as (kappa, beta)
+      // pairs, e.g. GA=1.5,0.5,1,3 for GA1505 and GA1030. They are binned in
+      // [0, 1] like the standard ones, so need kappa >= 1, and their names
+      // round kappa and beta to 0.1, so pairs must differ by that.
+      const vector<double> gas = analysisOptionValues(name(), "GA", {});
+      if (!gas.empty() && !_doAngularities) throw UserError(name() + ": GA needs the angularities observable group");
+      if (gas.size() % 2 != 0) throw UserError(name() + ": GA needs (kappa, beta) pairs");
+      _extraGAs.clear();
+      for (size_t k = 0; k < gas.size(); k += 2) {
+        const ExtraAngularity ga = { gas[k], gas[k+1], _angularityName(gas[k], gas[k+1]) };
+        if (ga.kappa < 1 || ga.kappa >= 10 || ga.beta < 0 || ga.beta >= 10)
+          throw UserError(name() + ": GA needs kappa in [1, 10) and beta in [0, 10), not " + toString(ga.kappa) + "/" + toString(ga.beta));
+        bool clash = ga.name == "GA1020" || ga.name == "GA1010" || ga.name == "GA1005" || ga.name == "GA2000";
+        for (const ExtraAngularity& other : _extraGAs) clash |= ga.name == other.name;
+        if (clash) throw UserError(name() + ": GA " + toString(ga.kappa) + "/" + toString(ga.beta) + " would book " + ga.name + " twice");
+        _extraGAs.push_back(ga);
+      }
+
+      // Jet selections to sweep over, all applied to the same clustering: by
+      // default only the standard one, without a histogram suffix, e.g.
+      // PTMIN=30,50:YMAX=4.5,2.5 for two suffixed sets of histograms. A
+      // single PTMIN or YMAX value applies to every selection. The suffixes
+      // round pT to 1 GeV and |y| to 0.1, so selections must differ by that.
+      _selections.clear();
+      const vector<double> ptmins = analysisOptionValues(name(), "PTMIN", {});
+      const vector<double> ymaxs = analysisOptionValues(name(), "YMAX", {});
+      const size_t nsel = max(ptmins.size(), ymaxs.size());
+      if (nsel == 0) {
+        _selections.push_back(JetSelection{ 30*GeV, 4.5, "" });
+      } else if ((ptmins.size() > 1 && ptmins.size() != nsel) || (ymaxs.size() > 1 && ymaxs.size() != nsel)) {
+        throw UserError(name() + ": PTMIN and YMAX need the same number of values");
+      }
+      for (size_t isel = 0; isel < nsel; ++isel) {
+        const double ptmin = ptmins.empty() ? 30 : ptmins[ptmins.size() > 1 ? isel : 0];
+        const double ymax = ymaxs.empty() ? 4.5 : ymaxs[ymaxs.size() > 1 ? isel : 0];
+        const string suffix = "_pt" + toString(int(round(ptmin))) + "_y" + toString(int(round(10*ymax)));
+        for (const JetSelection& sel : _selections)
+          if (sel.suffix == suffix)
+            throw UserError(name() + ": jet selections " + toString(sel.ptmin/GeV) + "/" + toString(sel.ymax) + " and " +
+                            toString(ptmin) + "/" + toString(ymax) + " would both book histograms " + suffix);
+        _selections.push_back(JetSelection{ ptmin*GeV, ymax, suffix });
+      }
+
+      // Approximate clustering from towers at the large radii, if enabled,
+      // e.g. TOWERS=0.1,0.1:TOWERRMIN=0.8 for 0.1 x 0.1 cells from R = 0.8.
+      // One event in VALIDATE (by default 100, 0 for none) is also clustered
+      // exactly, to measure the effect on the inclusive jet pT spectrum
+      const vector<double> towers = analysisOptionValues(name(), "TOWERS", {});
+      if (!towers.empty() && towers.size() != 2)
+        throw UserError(name() + ": TOWERS needs a rapidity and a phi cell size");
+      const TowerGrid grid = towers.empty() ? TowerGrid() :
+        TowerGrid(towers[0], towers[1], analysisOptionValues(name(), "TOWERRMIN", {0.8}).front());
+      _validateEvery = grid.enabled() ? size_t(analysisOptionValues(name(), "VALIDATE", {100}).front()) : 0;
+      _nevents = 0;
+
+      // All radii from one projection, indexed as in _radii
+      _pool = radiusScanPool();
+      MultiRadiusJets jets(fs, _jetalg, _radii, JetAlg::DECAY_MUONS);
+      jets.setWorkerPool(_pool);
+      jets.setTowerGrid(grid);
+      _jetsproj = &declare(jets, "Jets");
+      _exactJets = make_shared<MultiRadiusClustering>(jets);
+      _exactJets->setTowerGrid(TowerGrid());
+
+      // Jet cache: WRITEJETS=<file> writes this run's jets and bosons, and
+      // READJETS=<file> replays them instead of clustering. Either runs on
+      // the main thread only.
+      const string writejets = analysisOption(name(), "WRITEJETS"), readjets = analysisOption(name(), "READJETS");
+      double ptmin = _selections.front().ptmin;
+      for (const JetSelection& sel : _selections) ptmin = min(ptmin, sel.ptmin);
+      if (!readjets.empty()) {
+        _replay = make_shared<JetCacheReader>(readjets);
+        if (_replay->radii() != _radii) throw UserError(name() + ": jet cache " + readjets + " has different radii");
+        if (_replay->ptMin() > ptmin) throw UserError(name() + ": jet cache " + readjets + " has a higher jet pT threshold");
+        if (_doAngularities && !_replay->hasConstituents())
+          throw UserError(name() + ": jet cache " + readjets + " has no constituents for the angularities");
+        _replayJets = make_shared<MultiRadiusClustering>(jets);
+      }
+      if (!writejets.empty()) _cacheWriter = make_shared<JetCacheWriter>(writejets, _radii, _doAngularities, ptmin, sqrtS());
+
+      // RAW=1 leaves the histograms unscaled, for a merge of several runs
+      // which then scales them once, and MERGE=1 marks that merge, which
+      // analyses no events itself (see tools/runforked.cc)
+      _rawOnly = analysisOption(name(), "RAW") == "1";
+      _mergeOnly = analysisOption(name(), "MERGE") == "1";
+
+      // Histograms are addressed by selection and radius index and by
+      // observable, never by name
+      for (const JetSelection& sel : _selections) {
+        for (double R : _radii) _bookJets(_radiusSuffix(R) + sel.suffix);
+      }
+
+      // Tower validation, for the first selection: towers minus exact, and
+      // exact alone, both unnormalised
+      _hists.tdiff.assign(_radii.size(), Histo1DPtr());
+      _hists.texact.assign(_radii.size(), Histo1DPtr());
+      for (size_t i = 0; i < _radii.size() && _validateEvery > 0; ++i) {
+        if (_radii[i] < grid.rmin) continue;
+        const string hsuff = _radiusSuffix(_radii[i]) + _selections.front().suffix;
+        _hists.tdiff[i] = bookHisto1D("J_incl_pT" + hsuff + "_towerdiff", 100, 0, 1000);
+        _hists.texact[i] = bookHisto1D("J_incl_pT" + hsuff + "_towerexact", 100, 0, 1000);
+      }
+
+      // Boson pT and rapidity spectra
+      _hists.xhists[XPT] = bookHisto1D("XpT", 100, 0, 1000);
+      _hists.xhists[XY] = bookHisto1D("Xy", 25, 0, 2.5);
+
+      // Event-parallel running, if enabled: each worker clusters the events
+      // it is given and fills its own empty copy of the histograms
+      _shards.init(_replay || _cacheWriter ? shared_ptr<WorkerPool>() : eventParallelPool(),
+                   [&] {
+                     Shard s = { jets, *_exactJets, _emptyClone(_hists) };
+                     s.jets.setWorkerPool(shared_ptr<WorkerPool>());
+                     s.exact.setWorkerPool(shared_ptr<WorkerPool>());
+                     return s;
+                   },
+                   [this](const Record& r, Shard& s) {
+                     RIVET_STAGE_EVENT_PART(_timers);
+                     s.jets.calc(r.particles);
+                     if (r.validate) s.exact.calc(r.particles);
+                     _fill(s.jets, r.validate ? &s.exact : 0, r.weight, r.bosons, s.hists, shared_ptr<WorkerPool>());
+                   });
+
+    }
+
+
+    // Analysis
+    void analyze(const Event& event) {
+      const double weight = event.weight();
+      RIVET_STAGE_EVENT(_timers);
+
+      // Replay: the jets and bosons come from the jet cache, which also
+      // records which events were vetoed
+      if (_replay) {
+        if (!_replay->next(_replayEvent)) throw UserError(name() + ": the jet cache has fewer events than the run");
+        if (!_replayEvent.hasJets) vetoEvent;
+        _replayJets->load(_replayEvent);
+        _fill(*_replayJets, 0, _replayEvent.weight, _replayEvent.extras, _hists, _pool);
+        return;
+      }
+      if (_cacheWriter) _cacheWriter->beginEvent(weight);
+
+      // Get Higgs or Z
+      // const Particles bosons = apply<FinalState>(event, "FS") //< assuming status == 1
+      //   .particles(Cuts::pid == PID::ZBOSON || Cuts::pid == PID::HIGGS);
+      const PIDIndex& pids = apply<PIDIndex>(event, *_pidindex);
+      const Particles zs = pids.lastWith(PID::ZBOSON);
+      const Particles hs = pids.lastWith(PID::HIGGS);
+      const Particles bosons = zs + hs;
+      if (bosons.size() > 1) {
+        MSG_WARNING("More than one stable Z/H found... skipping event");
+        vetoEvent;
+      }
+      if (!bosons.empty() && bosons.front().absrap() > 2.4) vetoEvent;
+
+      const bool validate = _validateEvery > 0 && _nevents++ % _validateEvery == 0;
+
+      if (_shards.enabled()) {
+        const Particles& fsparticles = apply<FinalState>(event, *_fsproj).particles();
+        _shards.add(Record{ weight, validate, detached(bosons), detached(_jetsproj->selectInputs(fsparticles)) });
+        return;
+      }
 
-      for (double R : JET_RADII) {
+      if (validate) _exactJets->calc(_jetsproj->selectInputs(apply<FinalState>(event, *_fsproj).particles()));
+      const MultiRadiusJets& mrj = apply<MultiRadiusJets>(event, *_jetsproj);
+      if (_cacheWriter) _cacheWriter->write(bosons, mrj);
+      _fill(mrj, validate ? _exactJets.get() : 0, weight, bosons, _hists, _pool);
+    }
 
-        // Initialize the projections
-        const size_t iR = size_t(10 * R);
-        declare(FastJets(fs, FastJets::ANTIKT, R, JetAlg::DECAY_MUONS), "JetsAK" + toString(iR));
 
-        // Book histograms using this suffix
-        const string hsuff = "_R" + string(iR < 10 ? "0" : "") + toString(iR);
+    // Finalize
+    void finalize() {
+      // Fold in the workers' histograms before any scaling
+      _shards.merge([&](Shard& s) { _add(_hists, s.hists); });
+      if (_cacheWriter) _cacheWriter->finish(crossSection());
+      for (const string& line : _timers.report(_radii)) MSG_INFO(line);
+
+      // Summarise the tower validation. The event and jet counters are
+      // only this instance's, so a MERGE=1 run has none to report
+      for (size_t i = 0; i < _radii.size(); ++i) {
+        if (!_hists.tdiff[i] || _hists.texact[i]->sumW() == 0) continue;
+        double maxrel = 0, maxpt = 0;
+        for (size_t ib = 0; ib < _hists.texact[i]->numBins(); ++ib) {
+          const double exact = _hists.texact[i]->bin(ib).sumW();
+          if (exact == 0) continue;
+          const double rel = fabs(_hists.tdiff[i]->bin(ib).sumW()) / exact;
+          if (rel > maxrel) { maxrel = rel; maxpt = _hists.texact[i]->bin(ib).xMid(); }
+        }
+        MSG_INFO("Towers at R = " << _radii[i] << (_mergeOnly ? "" : ", " + toString(_hists.nvalidated) + " validation events")
+                 << ": J_incl_pT differs by "
+                 << 100*_hists.tdiff[i]->sumW()/_hists.texact[i]->sumW() << "% overall and by up to "
+                 << 100*maxrel << "% in a bin (at " << maxpt << " GeV)");
+      }
+
+      if (!_mergeOnly && _hists.nga2000above1 > 0) MSG_INFO(_hists.nga2000above1 << " jets with ga2000 > 1");
+      if (_rawOnly) return;
+      for (const auto& h : _hists.jhists)
+        for (Histo1DPtr hptr : h) if (hptr) scale(hptr, crossSection()/sumOfWeights());
+      for (const auto& hga : _hists.gahists)
+        for (Histo1DPtr hptr : hga) scale(hptr, crossSection()/sumOfWeights());
+      for (Histo1DPtr hptr : _hists.xhists)
+        scale(hptr, crossSection()/sumOfWeights());
+
+
+      /// @todo Compute inclusive Njet spectrum here
+    }
 
-        // Multiplicity histograms
-        _jhists[make_tuple(iR, "njet_excl")] = bookHisto1D("njet_excl" + hsuff, 10, -0.5, 9.5);
+
+  private:
+
+    /// @name Histogram handles
+    ///
+    /// Resolved once in init(): the jet histograms are indexed by selection
+    /// and radius index (as in _selections and _radii, radius fastest) and
+    /// then by observable. Histograms of observable groups which are not
+    /// run are null.
+    //@{
+
+    /// Jet histograms for each radius
+    enum JetObs { NJET_EXCL,
+                  J1_PT, J1_Y, J2_PT, J2_Y, J3_PT, J3_Y,
+                  JINCL_PT, JINCL_Y,
+                  J1DY0_PT, J1DY1_PT, J1DY2_PT, J1DY3_PT,
+                  GA1020, GA1010, GA1005, GA0000, GA2000,
+                  NUM_JETOBS };
+
+    /// Jet profiles for each radius
+    enum JetProfs { AV_NJET_VS_PTLEAD, AV_PT_VS_NJET, NUM_JETPROFS };
+
+    /// Boson histograms
+    enum BosonObs { XPT, XY, NUM_XOBS };
+
+    /// pT and |y| histograms of the @a ijet-th jet, counting from 1
+    static size_t _jetPt(size_t ijet) { return J1_PT + 2*(ijet-1); }
+    static size_t _jetY(size_t ijet) { return J1_Y + 2*(ijet-1); }
+
+    //@}
+
+    /// Histograms: the booked ones, or one worker's copy
+    struct Hists {
+      Hists() : nga2000above1(0), nvalidated(0) {  }
+      vector< array<Histo1DPtr, NUM_JETOBS> > jhists;
+      vector< array<Profile1DPtr, NUM_JETPROFS> > jhists_av;
+      vector< vector<Histo1DPtr> > gahists;
+      array<Histo1DPtr, NUM_XOBS> xhists;
+      vector<Histo1DPtr> tdiff, texact;
+      size_t nga2000above1, nvalidated;
+    };
+
+    /// Generalised angularities of one jet
+    struct Angularities {
+      double ga1020, ga1010, ga1005, ga0000, ga2000;
+      vector<double> extra;
+    };
+
+    /// Boson and clustering inputs copied out of one event
+    struct Record {
+      double weight;
+      bool validate;
+      Particles bosons;
+      Particles particles;
+    };
+
+    /// One worker's clusterings and histograms
+    struct Shard {
+      MultiRadiusClustering jets, exact;
+      Hists hists;
+    };
+
+
+    /// Histogram suffix for jet radius @a R, to the nearest 0.1
+    static string _radiusSuffix(double R) {
+      const size_t iR = size_t(round(10 * R));
+      return "_R" + string(iR < 10 ? "0" : "") + toString(iR);
+    }
+
+    /// Book the jet histograms of one selection and radius, with suffix @a hsuff
+    void _bookJets(const string& hsuff) {
+      array<Histo1DPtr, NUM_JETOBS> h;
+      array<Profile1DPtr, NUM_JETPROFS> hav;
+
+      // Multiplicity histograms
+      if (_doMultiplicity) {
+        h[NJET_EXCL] = bookHisto1D("njet_excl" + hsuff, 10, -0.5, 9.5);
         /// @todo Prefer to compute the inclusive spectrum from the excl one in the finalize()?
-        // _jhists[make_tuple(iR, "njet_incl")] = bookHisto1D("njet_incl" + hsuff, 10, -0.5, 9.5);
+        // h[NJET_INCL] = bookHisto1D("njet_incl" + hsuff, 10, -0.5, 9.5);
+        hav[AV_NJET_VS_PTLEAD] = bookProfile1D("av_NJet_vs_ptlead"  + hsuff, 100, 0, 1000);
+        hav[AV_PT_VS_NJET]     = bookProfile1D("av_pt_vs_Njet"      + hsuff, 10, -0.5,9.5);
+      }
 
-        // Jet pT and rapidity spectra
+      // Jet pT and rapidity spectra
+      if (_doSpectra) {
         for (size_t ijet = 1; ijet <= 3; ++ijet) {
           const string hpre = "J" + toString(ijet);
-          _jhists[make_tuple(iR, hpre + "_pT")] = bookHisto1D(hpre + "_pT" + hsuff, 100, 0, 1000);
-          _jhists[make_tuple(iR, hpre + "_y")] = bookHisto1D(hpre + "_y" + hsuff, 50, 0, 5);
+          h[_jetPt(ijet)] = bookHisto1D(hpre + "_pT" + hsuff, 100, 0, 1000);
+          h[_jetY(ijet)] = bookHisto1D(hpre + "_y" + hsuff, 50, 0, 5);
         }
 
         if (true){  // for the scope
           const string hpre = "J_incl";
-          _jhists[make_tuple(iR, hpre + "_pT")] = bookHisto1D(hpre + "_pT" + hsuff, 100, 0, 1000);
-          _jhists[make_tuple(iR, hpre + "_y")] = bookHisto1D(hpre + "_y" + hsuff, 50, 0, 5);
-        }
-
-        if (true){  // for the scope
-	  _jhists_av[make_tuple(iR, "av_NJet_vs_ptlead" )]= bookProfile1D("av_NJet_vs_ptlead"  + hsuff, 100, 0, 1000);
-          _jhists_av[make_tuple(iR, "av_pt_vs_Njet" )]    = bookProfile1D("av_pt_vs_Njet"      + hsuff, 10, -0.5,9.5);
+          h[JINCL_PT] = bookHisto1D(hpre + "_pT" + hsuff, 100, 0, 1000);
+          h[JINCL_Y] = bookHisto1D(hpre + "_y" + hsuff, 50, 0, 5);
         }
 
         // Lead jet pT spectra in |y| bins 0-1-2-3-4
         for (size_t iy = 0; iy <= 3; ++iy) {
           const string hpre = "J1dy" + toString(iy);
-          _jhists[make_tuple(iR, hpre + "_pT")] = bookHisto1D(hpre + "_pT" + hsuff, 100, 0, 1000);
+          h[J1DY0_PT + iy] = bookHisto1D(hpre + "_pT" + hsuff, 100, 0, 1000);
         }
-
-        // Angularities (treat multiplicity differently)
-        _jhists[make_tuple(iR, "GA0000")] = bookHisto1D("GA0000"+hsuff, 151, -0.5, 150.5);
-        for (const string& s : {"GA1020", "GA1010", "GA1005", "GA2000"}) { //< without GA0000 = multiplicity
-          _jhists[make_tuple(iR, s)] = bookHisto1D(s+hsuff, 200, 0.0, 1.0); //< ranges not quite [0,1] since no WTA jet axis
-        }
-
       }
 
-      // Boson pT and rapidity spectra
-      _xhists["XpT"] = bookHisto1D("XpT", 100, 0, 1000);
-      _xhists["Xy"] = bookHisto1D("Xy", 25, 0, 2.5);
+      // Angularities (treat multiplicity differently)
+      if (_doAngularities) {
+        h[GA0000] = bookHisto1D("GA0000"+hsuff, 151, -0.5, 150.5);
+        // Without GA0000 = multiplicity; ranges not quite [0,1] since no WTA jet axis
+        h[GA1020] = bookHisto1D("GA1020"+hsuff, 200, 0.0, 1.0);
+        h[GA1010] = bookHisto1D("GA1010"+hsuff, 200, 0.0, 1.0);
+        h[GA1005] = bookHisto1D("GA1005"+hsuff, 200, 0.0, 1.0);
+        h[GA2000] = bookHisto1D("GA2000"+hsuff, 200, 0.0, 1.0);
+      }
+      vector<Histo1DPtr> hga;
+      for (const ExtraAngularity& ga : _extraGAs) hga.push_back(bookHisto1D(ga.name + hsuff, 200, 0.0, 1.0));
 
+      _hists.jhists.push_back(h);
+      _hists.jhists_av.push_back(hav);
+      _hists.gahists.push_back(hga);
     }
 
 
-    // Analysis
-    void analyze(const Event& event) {
-      const double weight = event.weight();
+    /// @brief Fill @a hists with the boson and the jets of every selection at every radius
+    ///
+    /// If @a exact is given, it is the same event clustered without towers,
+    /// for the tower validation.
+    void _fill(const MultiRadiusClustering& mrj, const MultiRadiusClustering* exact, double weight,
+               const Particles& bosons, Hists& hists, const shared_ptr<WorkerPool>& pool) {
 
-      // Get Higgs or Z
-      // const Particles bosons = apply<FinalState>(event, "FS") //< assuming status == 1
-      //   .particles(Cuts::pid == PID::ZBOSON || Cuts::pid == PID::HIGGS);
-      const Particles zs = event.allParticles(lastParticleWith(Cuts::pid == PID::ZBOSON));
-      const Particles hs = event.allParticles(lastParticleWith(Cuts::pid == PID::HIGGS));
-      const Particles bosons = zs + hs;
-      if (bosons.size() > 1) {
-        MSG_WARNING("More than one stable Z/H found... skipping event");
-        vetoEvent;
-      }
       // Fill boson pT and |y| spectra
       if (!bosons.empty()) {
         const Particle& boson = bosons.front();
-        if (boson.absrap()>2.4)vetoEvent;
-        _xhists["XpT"]->fill(boson.pT()/GeV, weight);
-        _xhists["Xy"]->fill(boson.absrap(), weight);
+        hists.xhists[XPT]->fill(boson.pT()/GeV, weight);
+        hists.xhists[XY]->fill(boson.absrap(), weight);
       }
 
-      for (double R : JET_RADII) {
-        const size_t iR = size_t(10 * R);
+      // Jets and angularities for every radius, with the loosest of the
+      // selections. Radii are independent, so this runs on the worker pool
+      // if enabled; histograms are then filled below in selection and radius
+      // order whatever the threading.
+      double ptmin = _selections.front().ptmin, ymax = _selections.front().ymax;
+      for (const JetSelection& sel : _selections) {
+        ptmin = min(ptmin, sel.ptmin);
+        ymax = max(ymax, sel.ymax);
+      }
+      const Cut jetcut = Cuts::pT > ptmin && Cuts::absrap < ymax;
+      vector<Jets> rjets(mrj.numRadii());
+      vector< vector<Angularities> > rgas(mrj.numRadii());
+      RIVET_STAGE_CONTEXT(timers);
+      forEachIndex(pool, mrj.numRadii(), [&](size_t i) {
+          {
+            RIVET_STAGE_TIMER_IN(timers, "jet selection", i);
+            rjets[i] = mrj.lightJetsByPt(i, jetcut);
+          }
+          if (!_doAngularities) return;
+          RIVET_STAGE_TIMER_IN(timers, "angularities", i);
+          vector<int> constituents;
+          for (const Jet& j : rjets[i])
+            rgas[i].push_back(_angularities(j, mrj.radius(i), mrj.constituents(i, j, constituents)));
+        });
+
+      for (const vector<Angularities>& gas : rgas)
+        for (const Angularities& ga : gas)
+          if (ga.ga2000 > 1) hists.nga2000above1 += 1;
+
+      // With one selection, the jets are already those it selects
+      const size_t nR = mrj.numRadii();
+      for (size_t isel = 0; isel < _selections.size(); ++isel) {
+        for (size_t i = 0; i < nR; ++i) {
+          RIVET_STAGE_TIMER_R("fills", i);
+          const size_t ih = isel*nR + i;
+          if (_selections.size() == 1) {
+            _fillJets(hists.jhists[ih], hists.jhists_av[ih], hists.gahists[ih], rjets[i], rgas[i], weight);
+            continue;
+          }
+          Jets jets;
+          vector<Angularities> gas;
+          for (size_t k = 0; k < rjets[i].size(); ++k) {
+            const Jet& j = rjets[i][k];
+            if (j.pT() <= _selections[isel].ptmin || j.absrap() >= _selections[isel].ymax) continue;
+            jets.push_back(j);
+            if (_doAngularities) gas.push_back(rgas[i][k]);
+          }
+          _fillJets(hists.jhists[ih], hists.jhists_av[ih], hists.gahists[ih], jets, gas, weight);
+        }
+      }
+
+      // Tower validation: the first selection's jets from towers and exact
+      if (exact) {
+        const Cut vcut = Cuts::pT > _selections.front().ptmin && Cuts::absrap < _selections.front().ymax;
+        hists.nvalidated += 1;
+        for (size_t i = 0; i < nR; ++i) {
+          if (!hists.tdiff[i]) continue;
+          for (const Jet& j : mrj.lightJetsByPt(i, vcut)) hists.tdiff[i]->fill(j.pT()/GeV, weight);
+          for (const Jet& j : exact->lightJetsByPt(i, vcut)) {
+            hists.tdiff[i]->fill(j.pT()/GeV, -weight);
+            hists.texact[i]->fill(j.pT()/GeV, weight);
+          }
+        }
+      }
+
+    }
+
 
-        // Get jets
-        const FastJets& fj = apply<FastJets>(event, "JetsAK" + toString(iR));
-        const Jets& jets = fj.jetsByPt(Cuts::pT > 30*GeV && Cuts::absrap < 4.5);
+    /// Fill the histograms @a h, profiles @a hav and extra angularity histograms @a hga of one
+    /// selection and radius with its pT-ordered @a jets, whose angularities are @a gas
+    void _fillJets(const array<Histo1DPtr, NUM_JETOBS>& h, const array<Profile1DPtr, NUM_JETPROFS>& hav,
+                   const vector<Histo1DPtr>& hga, const Jets& jets, const vector<Angularities>& gas, double weight) const {
 
-        // Jet multiplicity histograms
-        _jhists[make_tuple(iR, "njet_excl")]->fill(jets.size(), weight);
+      // Jet multiplicity histograms
+      if (_doMultiplicity) h[NJET_EXCL]->fill(jets.size(), weight);
 
 
 
-        // for (size_t ijet = 1; ijet <= jets.size(); ++ijet) {
-        //   _jhists[make_tuple(iR, "njet_incl")]->fill(ijet, weight);
-        // }
+      // for (size_t ijet = 1; ijet <= jets.size(); ++ijet) {
+      //   h[NJET_INCL]->fill(ijet, weight);
+      // }
 
-        // Need some R-jets from here on
-        if (jets.empty()) continue;
+      // Need some R-jets from here on
+      if (jets.empty()) return;
 
-        // Lead pT spectra in |y| bins
-        const Jet& j1 = jets.front();
-        auto httmp=0.;
-        for (const Jet& j : jets) httmp+=j.pT()/GeV;
+      // Lead pT spectra in |y| bins
+      const Jet& j1 = jets.front();
+      auto httmp=0.;
+      for (const Jet& j : jets) httmp+=j.pT()/GeV;
  
-        _jhists_av[make_tuple(iR, "av_NJet_vs_ptlead" )]->fill( j1.pT()/GeV ,jets.size(), weight  );
-        _jhists_av[make_tuple(iR, "av_pt_vs_Njet" )]    ->fill( jets.size() ,httmp/jets.size() , weight );
-
-        const double y1 = j1.absrap();
-        const size_t iy = y1 < 1 ? 0 : (y1 < 2 ? 1 : (y1 < 3 ? 2 : (y1 < 4 ? 3 : 4)));
-        if (iy < 4) _jhists[make_tuple(iR, "J1dy" + toString(iy) + "_pT")]->fill(j1.pT()/GeV, weight);
-        // if (y1 < 1) {
-        //   _jhists[make_tuple(iR, "J1dy0_pT")]->fill(j1.pT()/GeV, weight);
-        // } else if (y1 < 2) {
-        //   _jhists[make_tuple(iR, "J1dy1_pT")]->fill(j1.pT()/GeV, weight);
-        // } else if (y1 < 3) {
-        //   _jhists[make_tuple(iR, "J1dy2_pT")]->fill(j1.pT()/GeV, weight);
-        // } else if (y1 < 4) {
-        //   _jhists[make_tuple(iR, "J1dy3_pT")]->fill(j1.pT()/GeV, weight);
-        // }
-
-        size_t ijet = 0;
-        for (const Jet& j : jets) {
-          ijet += 1;
-
-          // // Everything in |y| bins
-          // // Safe index decoding from Rivet 2.6.0:
-          // // const int iy = binIndex(j.absrap(), RAP_BINEDGES);
-          // // if (iy < 0) continue;
-          // // For now:
-          // if (!inRange(j.absrap(), RAP_BINEDGES.front(), RAP_BINEDGES.back())) continue; // outside range
-          // const size_t iy = std::distance(RAP_BINEDGES.begin(), std::upper_bound(RAP_BINEDGES.begin(), RAP_BINEDGES.end(), j.absrap()));
-
-          // Jet pT and rapidity spectra
-          if (ijet <= 3) {
-            const string hpre = "J" + toString(ijet);
-            _jhists[make_tuple(iR, hpre+"_pT")]->fill(j.pT()/GeV, weight);
-            _jhists[make_tuple(iR, hpre+"_y")]->fill(j.absrap(), weight);
-          }
+      if (_doMultiplicity) {
+        hav[AV_NJET_VS_PTLEAD]->fill( j1.pT()/GeV ,jets.size(), weight  );
+        hav[AV_PT_VS_NJET]    ->fill( jets.size() ,httmp/jets.size() , weight );
+      }
 
-          if ( true ){ // for the scope 
-          const string hpre = "J_incl"; 
-          _jhists[make_tuple(iR, hpre+"_pT")]->fill(j.pT()/GeV, weight);                                                                                                          
-          _jhists[make_tuple(iR, hpre+"_y")]->fill(j.absrap(), weight);
-          }
+      const double y1 = j1.absrap();
+      const size_t iy = y1 < 1 ? 0 : (y1 < 2 ? 1 : (y1 < 3 ? 2 : (y1 < 4 ? 3 : 4)));
+      if (_doSpectra && iy < 4) h[J1DY0_PT + iy]->fill(j1.pT()/GeV, weight);
+      // if (y1 < 1) {
+      //   h[J1DY0_PT]->fill(j1.pT()/GeV, weight);
+      // } else if (y1 < 2) {
+      //   h[J1DY1_PT]->fill(j1.pT()/GeV, weight);
+      // } else if (y1 < 3) {
+      //   h[J1DY2_PT]->fill(j1.pT()/GeV, weight);
+      // } else if (y1 < 4) {
+      //   h[J1DY3_PT]->fill(j1.pT()/GeV, weight);
+      // }
+
+      size_t ijet = 0;
+      for (const Jet& j : jets) {
+        ijet += 1;
+
+        // // Everything in |y| bins
+        // // Safe index decoding from Rivet 2.6.0:
+        // // const int iy = binIndex(j.absrap(), RAP_BINEDGES);
+        // // if (iy < 0) continue;
+        // // For now:
+        // if (!inRange(j.absrap(), RAP_BINEDGES.front(), RAP_BINEDGES.back())) continue; // outside range
+        // const size_t iy = std::distance(RAP_BINEDGES.begin(), std::upper_bound(RAP_BINEDGES.begin(), RAP_BINEDGES.end(), j.absrap()));
 
-          
-          // Angularities
-          /// @todo The GAs are computed across all jets -- right?
-          double scalar_pt = 0; //scalar_pt2 = 0;
-          double sum1020 = 0, sum1010 = 0, sum1005 = 0, sum0000 = 0, sum2000 = 0;
-          for (const Particle& p : j.particles()) {
-            const double pt = p.pT();
-            const double dr = deltaR(p, j);
-            scalar_pt += pt;
-            //scalar_pt2 += sqr(pt);
-            sum1020 += pt      * sqr(dr);
-            sum1010 += pt      * dr;
-            sum1005 += pt      * sqrt(dr);
-            sum0000 += 1       * 1;
-            sum2000 += sqr(pt) * 1;
-          }
-          const double ga1020 = sum1020 / scalar_pt      / sqr(R);
-          const double ga1010 = sum1010 / scalar_pt      / R;
-          const double ga1005 = sum1005 / scalar_pt      / sqrt(R);
-          const double ga0000 = sum0000 / 1.             / 1.;
-          const double ga2000 = sum2000 / sqr(scalar_pt) / 1.;
-          //
-          if (ga2000 > 1) MSG_INFO("ga2000 > 1: " << sum2000 << " / " << sqr(scalar_pt) << " = " << ga2000);
-          //
-          _jhists[make_tuple(iR, "GA1020")]->fill(ga1020, weight);
-          _jhists[make_tuple(iR, "GA1010")]->fill(ga1010, weight);
-          _jhists[make_tuple(iR, "GA1005")]->fill(ga1005, weight);
-          _jhists[make_tuple(iR, "GA0000")]->fill(ga0000, weight);
-          _jhists[make_tuple(iR, "GA2000")]->fill(ga2000, weight);
+        // Jet pT and rapidity spectra
+        if (_doSpectra && ijet <= 3) {
+          h[_jetPt(ijet)]->fill(j.pT()/GeV, weight);
+          h[_jetY(ijet)]->fill(j.absrap(), weight);
+        }
 
+        if (_doSpectra){ // for the scope 
+        h[JINCL_PT]->fill(j.pT()/GeV, weight);
+        h[JINCL_Y]->fill(j.absrap(), weight);
         }
+
+        
+        // Angularities
+        if (!_doAngularities) continue;
+        const Angularities& ga = gas[ijet-1];
+        h[GA1020]->fill(ga.ga1020, weight);
+        h[GA1010]->fill(ga.ga1010, weight);
+        h[GA1005]->fill(ga.ga1005, weight);
+        h[GA0000]->fill(ga.ga0000, weight);
+        h[GA2000]->fill(ga.ga2000, weight);
+        for (size_t k = 0; k < hga.size(); ++k) hga[k]->fill(ga.extra[k], weight);
+
       }
+    }
 
+
+    /// Empty copy of @a hists with the same binning
+    static Hists _emptyClone(const Hists& hists) {
+      Hists rtn = hists;
+      for (auto& h : rtn.jhists)
+        for (Histo1DPtr& hptr : h) if (hptr) hptr = emptyClone(hptr);
+      for (auto& hav : rtn.jhists_av)
+        for (Profile1DPtr& hptr : hav) if (hptr) hptr = emptyClone(hptr);
+      for (auto& hga : rtn.gahists)
+        for (Histo1DPtr& hptr : hga) hptr = emptyClone(hptr);
+      for (Histo1DPtr& hptr : rtn.xhists) hptr = emptyClone(hptr);
+      for (Histo1DPtr& hptr : rtn.tdiff) if (hptr) hptr = emptyClone(hptr);
+      for (Histo1DPtr& hptr : rtn.texact) if (hptr) hptr = emptyClone(hptr);
+      rtn.nga2000above1 = 0;
+      rtn.nvalidated = 0;
+      return rtn;
     }
 
+    /// Add the contents of @a from to @a to
+    static void _add(Hists& to, const Hists& from) {
+      for (size_t i = 0; i < to.jhists.size(); ++i) {
+        for (size_t o = 0; o < NUM_JETOBS; ++o)
+          if (to.jhists[i][o]) *to.jhists[i][o] += *from.jhists[i][o];
+        for (size_t o = 0; o < NUM_JETPROFS; ++o)
+          if (to.jhists_av[i][o]) *to.jhists_av[i][o] += *from.jhists_av[i][o];
+        for (size_t o = 0; o < to.gahists[i].size(); ++o) *to.gahists[i][o] += *from.gahists[i][o];
+      }
+      for (size_t o = 0; o < NUM_XOBS; ++o) *to.xhists[o] += *from.xhists[o];
+      for (size_t i = 0; i < to.tdiff.size(); ++i) {
+        if (!to.tdiff[i]) continue;
+        *to.tdiff[i] += *from.tdiff[i];
+        *to.texact[i] += *from.texact[i];
+      }
+      to.nga2000above1 += from.nga2000above1;
+      to.nvalidated += from.nvalidated;
+    }
 
-    // Finalize
-    void finalize() {
-      for (auto k_hptr : _jhists)
-        scale(k_hptr.second, crossSection()/sumOfWeights());
-      for (auto k_hptr : _xhists)
-        scale(k_hptr.second, crossSection()/sumOfWeights());
 
+    /// Compute the generalised angularities of jet @a j of radius @a R, with constituents @a constituents
+    Angularities _angularities(const Jet& j, double R, const ConstituentView& constituents) const {
+      /// @todo The GAs are computed across all jets -- right?
+      const AngularitySums sums = angularitySums(constituents, j.eta(), j.phi());
+      Angularities ga;
+      ga.ga1020 = sums.ga1020(R);
+      ga.ga1010 = sums.ga1010(R);
+      ga.ga1005 = sums.ga1005(R);
+      ga.ga0000 = sums.ga0000();
+      ga.ga2000 = sums.ga2000();
+      for (const ExtraAngularity& extra : _extraGAs)
+        ga.extra.push_back(angularity(constituents, j.eta(), j.phi(), R, extra.kappa, extra.beta));
+      return ga;
+    }
 
-      /// @todo Compute inclusive Njet spectrum here
+
+    /// Jet pT and |y| selection, and the suffix of its histograms
+    struct JetSelection {
+      double ptmin, ymax;
+      string suffix;
+    };
+
+    /// Generalised angularity beyond the standard five, and its histogram name
+    struct ExtraAngularity {
+      double kappa, beta;
+      string name;
+    };
+
+    /// Histogram name of the generalised angularity (@a kappa, @a beta), e.g. GA1505
+    static string _angularityName(double kappa, double beta) {
+      auto code = [](double x) { const int i = int(round(10*x)); return string(i < 10 ? "0" : "") + toString(i); };
+      return "GA" + code(kappa) + code(beta);
     }
 
+    /// @name Options
+    //@{
+    vector<double> _radii;
+    vector<JetSelection> _selections;
+    vector<ExtraAngularity> _extraGAs;
+    bool _doMultiplicity, _doSpectra, _doAngularities;
+    bool _rawOnly, _mergeOnly;
+    //@}
 
-  private:
+    /// Exact clustering for the tower validation
+    shared_ptr<MultiRadiusClustering> _exactJets;
+
+    /// @name Jet cache writing and replay
+    //@{
+    shared_ptr<JetCacheWriter> _cacheWriter;
+    shared_ptr<JetCacheReader> _replay;
+    shared_ptr<MultiRadiusClustering> _replayJets;
+    CachedEvent _replayEvent;
+    //@}
+
+    /// Tower validation frequency, and the event count for it
+    size_t _validateEvery, _nevents;
+
+    /// Optional pool for the per-radius work, shared with the jet projection
+    shared_ptr<WorkerPool> _pool;
+
+    /// Registered projections, to apply without a lookup by name
+    const FinalState* _fsproj;
+    const PIDIndex* _pidindex;
+    const MultiRadiusJets* _jetsproj;
 
-    map<tuple<size_t,string>, Histo1DPtr> _jhists;
-    map<tuple<size_t,string>, Profile1DPtr> _jhists_av;
+    Hists _hists;
 
-    map<string, Histo1DPtr> _xhists;
+    /// Per-worker state for event-parallel running
+    EventShards<Record, Shard> _shards;
 
+    /// Stage timings, if compiled in
+    StageTimers _timers;
+
+  protected:
+
+    /// Jet algorithm used for every radius
+    FastJets::JetAlgName _jetalg;
+
+  };
+
+
+  // Cambridge/Aachen radius scan, all radii from one clustering
+  struct LH2017_ZHJETS_CA : public LH2017_ZHJETS {
+    LH2017_ZHJETS_CA() : LH2017_ZHJETS("LH2017_ZHJETS_CA") {
+      _jetalg = FastJets::CAM;
+    }
   };
 
 
   // Hook for the plugin system.
   DECLARE_RIVET_PLUGIN(LH2017_ZHJETS);
+  DECLARE_RIVET_PLUGIN(LH2017_ZHJETS_CA);
 
 
 }
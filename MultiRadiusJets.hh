@@ -0,0 +1,662 @@
+// -*- C++ -*-
+#ifndef RIVET_MultiRadiusJets_HH
+#define RIVET_MultiRadiusJets_HH
+
+#include "Rivet/Projection.hh"
+#include "Rivet/Projections/FinalState.hh"
+#include "Rivet/Projections/FastJets.hh"
+#include "fastjet/ClusterSequence.hh"
+#include <algorithm>
+#include "WorkerPool.hh"
+#include "ConstituentView.hh"
+#include "CachedJets.hh"
+#include "StageTimers.hh"
+
+namespace Rivet {
+
+
+  /// @brief A (y, phi) grid of massless towers, for approximate clustering
+  ///
+  /// Each tower has the scalar pT sum of the particles in its cell, along
+  /// the cell centre. Radii of at least @a rmin are clustered from the
+  /// towers instead of the particles, which for large radii cuts the input
+  /// count at little cost to jet-level observables. Towering is off unless
+  /// both cell sizes are positive.
+  struct TowerGrid {
+
+    /// Constructor from the cell sizes and the smallest towered radius
+    TowerGrid(double dy_=0, double dphi_=0, double rmin_=0)
+      : dy(dy_), dphi(dphi_), rmin(rmin_)
+    {  }
+
+    /// Whether towering is on
+    bool enabled() const { return dy > 0 && dphi > 0; }
+
+    /// @brief The towers of @a particles, as pid 0 particles, in (y, phi) cell order
+    ///
+    /// The phi size is rounded to a whole number of cells around the circle.
+    Particles towers(const Particles& particles) const {
+      const size_t nphi = std::max(size_t(1), size_t(std::round(2*M_PI/dphi)));
+      const double cphi = 2*M_PI/nphi;
+      std::map<std::pair<long, size_t>, double> cells;
+      for (const Particle& p : particles) {
+        const FourMomentum& mom = p.momentum();
+        const long iy = long(std::floor(mom.rapidity()/dy));
+        const size_t iphi = std::min(size_t(mom.phi(ZERO_2PI)/cphi), nphi-1);
+        cells[std::make_pair(iy, iphi)] += mom.pT();
+      }
+      Particles rtn;
+      rtn.reserve(cells.size());
+      for (const auto& c : cells) {
+        const double y = (c.first.first + 0.5)*dy, phi = (c.first.second + 0.5)*cphi, pt = c.second;
+        rtn.push_back(Particle(0, FourMomentum(pt*std::cosh(y), pt*std::cos(phi), pt*std::sin(phi), pt*std::sinh(y))));
+      }
+      return rtn;
+    }
+
+    /// Cell sizes in rapidity and phi
+    double dy, dphi;
+
+    /// Smallest radius clustered from towers
+    double rmin;
+
+  };
+
+
+
+  /// @brief Clustering of one set of particles at several radii
+  ///
+  /// The input selection and the conversion to PseudoJets (including
+  /// FastJet's cached rapidity and phi) are done once and shared by the
+  /// clusterings at every radius, but for anti-kT and kT each radius still
+  /// builds its own ClusterSequence: their merging order depends on R, so
+  /// the per-radius clustering cost is unchanged. Radii are addressed by
+  /// their index in the list given to the constructor.
+  ///
+  /// For Cambridge/Aachen the particles are clustered only once, at the
+  /// largest radius. C/A merges pairs in order of increasing \f$ \Delta R \f$
+  /// and stops once the closest pair is further apart than R, so the jets at
+  /// any smaller R are exactly the objects in the R_max history just before
+  /// the first merging with \f$ \Delta R \ge R \f$, i.e. the exclusive jets at
+  /// \f$ d_\mathrm{cut} = (R/R_\mathrm{max})^2 \f$.
+  ///
+  /// With a TowerGrid set, the radii it covers are clustered from towers
+  /// made of the particles, and the others from the particles themselves.
+  ///
+  /// The jets can also be loaded from a jet cache instead of clustered, for
+  /// replaying a run; the cluster sequences are then not available.
+  ///
+  /// With a worker pool attached, the per-radius clusterings run in parallel.
+  /// Every accessor is const and safe to call from several threads at once.
+  ///
+  /// This is plain FastJet bookkeeping with no projection machinery, so
+  /// copies can be used to cluster away from the main thread.
+  class MultiRadiusClustering {
+  public:
+
+    /// Constructor from a jet algorithm and a list of radii
+    MultiRadiusClustering(FastJets::JetAlgName alg, const vector<double>& radii)
+      : _alg(alg), _radii(radii)
+    {
+      if (_radii.empty()) throw UserError("MultiRadiusJets needs at least one jet radius");
+
+      fastjet::JetAlgorithm fjalg;
+      switch (alg) {
+      case FastJets::KT:     fjalg = fastjet::kt_algorithm; break;
+      case FastJets::CAM:    fjalg = fastjet::cambridge_algorithm; break;
+      case FastJets::ANTIKT: fjalg = fastjet::antikt_algorithm; break;
+      default: throw UserError("MultiRadiusJets only supports the KT, CAM and ANTIKT algorithms");
+      }
+      for (double R : _radii) _jdefs.push_back(fastjet::JetDefinition(fjalg, R, fastjet::E_scheme));
+    }
+
+
+    /// @brief Cluster the radii in parallel on @a pool (null for serial)
+    ///
+    /// Needs a thread-safe FastJet build (3.3 or later) when the pool has
+    /// more than one thread.
+    void setWorkerPool(const shared_ptr<WorkerPool>& pool) {
+      // Print the banner now rather than racing for it in the workers
+      if (pool) fastjet::ClusterSequence::print_banner();
+      _pool = pool;
+    }
+
+    /// Cluster the radii covered by @a towers from towers, or none if it is off
+    void setTowerGrid(const TowerGrid& towers) { _towers = towers; }
+
+    /// The tower grid in use
+    const TowerGrid& towerGrid() const { return _towers; }
+
+
+    /// @name Radius bookkeeping
+    //@{
+
+    /// Number of radii
+    size_t numRadii() const { return _radii.size(); }
+
+    /// Jet radius at index @a iR
+    double radius(size_t iR) const { return _radii[iR]; }
+
+    /// All jet radii, in constructor order
+    const vector<double>& radii() const { return _radii; }
+
+    //@}
+
+
+    /// @brief Upper bound on the pT of any jet, at any radius, from the inputs @a particles
+    ///
+    /// A jet's pT is the length of the vector sum of its constituents'
+    /// transverse momenta, so it is at most the largest such sum over the
+    /// particles in one half-plane in phi. Every merging joins two objects
+    /// less than R apart, and an object's rapidity lies within the range of
+    /// its constituents', so no jet spans a rapidity gap wider than R_max:
+    /// the half-plane sums are taken separately between such gaps.
+    ///
+    /// One pass of the particles into a coarse (y, phi) grid, with no
+    /// clustering. Every grid approximation widens the bound, so it holds
+    /// for every algorithm and radius. With towers, the radii clustered
+    /// from particles and those clustered from towers are bounded from
+    /// their own inputs: moving a particle to its cell centre can change
+    /// its half-plane or close a rapidity gap, so neither bound holds for
+    /// the other's jets.
+    double maxJetPtBound(const Particles& inputs) const {
+      bool fromParticles = false, fromTowers = false;
+      for (size_t iR = 0; iR < _radii.size(); ++iR) {
+        if (_inputSet(iR) == 1) fromTowers = true;
+        else fromParticles = true;
+      }
+      double rtn = 0;
+      if (fromParticles) rtn = _maxJetPtBound(inputs);
+      if (fromTowers) rtn = std::max(rtn, _maxJetPtBound(_towers.towers(inputs)));
+      return rtn;
+    }
+
+
+    /// @name Jet access
+    //@{
+
+    /// Unsorted PseudoJets at radius index @a iR
+    const PseudoJets& pseudojets(size_t iR) const { return _pjets[iR]; }
+
+    /// The cluster sequence which produced the jets at radius index @a iR, null for cached jets
+    const fastjet::ClusterSequence* clusterSeq(size_t iR) const { return _cseqs[iR].get(); }
+
+    /// Unsorted jets at radius index @a iR passing cut @a c
+    Jets jets(size_t iR, const Cut& c=Cuts::open()) const {
+      Jets rtn;
+      for (const PseudoJet& pj : _pjets[iR]) {
+        if (!c->accept(FourMomentum(pj.E(), pj.px(), pj.py(), pj.pz()))) continue;
+        rtn.push_back(_mkJet(iR, pj));
+      }
+      return rtn;
+    }
+
+    /// Jets at radius index @a iR passing cut @a c, sorted by decreasing pT
+    Jets jetsByPt(size_t iR, const Cut& c=Cuts::open()) const {
+      return sortByPt(jets(iR, c));
+    }
+
+    /// @brief Jets at radius index @a iR passing cut @a c, sorted by decreasing pT, without constituents
+    ///
+    /// Cheaper than jetsByPt() for large jets: no Particles are copied. The
+    /// constituents are available through constituents().
+    Jets lightJetsByPt(size_t iR, const Cut& c=Cuts::open()) const {
+      Jets rtn;
+      for (const PseudoJet& pj : _pjets[iR]) {
+        if (!c->accept(FourMomentum(pj.E(), pj.px(), pj.py(), pj.pz()))) continue;
+        rtn.push_back(Jet(pj, Particles()));
+      }
+      return sortByPt(rtn);
+    }
+
+    /// @brief The @a k highest-pT jets at radius index @a iR passing cut @a c, sorted by decreasing pT, without constituents
+    ///
+    /// Keeps only the current @a k hardest while scanning the jets, so the
+    /// full passing list is never built or sorted.
+    Jets hardestJets(size_t iR, size_t k, const Cut& c=Cuts::open()) const {
+      vector<const PseudoJet*> best;
+      best.reserve(k+1);
+      for (const PseudoJet& pj : _pjets[iR]) {
+        if (k == 0) break;
+        if (best.size() == k && pj.pt2() <= best.back()->pt2()) continue;
+        if (!c->accept(FourMomentum(pj.E(), pj.px(), pj.py(), pj.pz()))) continue;
+        // Insert in decreasing pT order and drop the softest if over k
+        auto pos = std::upper_bound(best.begin(), best.end(), &pj,
+                                    [](const PseudoJet* a, const PseudoJet* b) { return a->pt2() > b->pt2(); });
+        best.insert(pos, &pj);
+        if (best.size() > k) best.pop_back();
+      }
+      Jets rtn;
+      rtn.reserve(best.size());
+      for (const PseudoJet* pj : best) rtn.push_back(Jet(*pj, Particles()));
+      return rtn;
+    }
+
+    /// @brief Constituents of jet @a j (from this clustering, at radius index @a iR)
+    ///
+    /// The indices are written to @a buffer, whose capacity is reused, and
+    /// the kinematics are read from the event-level arrays of this
+    /// clustering. The view is valid until either is changed.
+    ConstituentView constituents(size_t iR, const Jet& j, vector<int>& buffer) const {
+      buffer.clear();
+      if (!_cached.empty()) {
+        const CachedJets& cj = _cached[iR];
+        if (!cj.hasConstituents()) throw UserError("The jet cache has no jet constituents");
+        const int ij = j.pseudojet().user_index();
+        for (uint32_t k = cj.offsets[ij]; k < cj.offsets[ij+1]; ++k) buffer.push_back(k);
+        const ConstituentView rtn = { buffer.size(), buffer.data(), cj.cpt.data(), cj.ceta.data(), cj.cphi.data() };
+        return rtn;
+      }
+      _addConstituents(*_cseqs[iR], j.pseudojet().cluster_hist_index(), buffer);
+      const Inputs& in = _inputs[_inputSet(iR)];
+      const ConstituentView rtn = { buffer.size(), buffer.data(), in.pt.data(), in.eta.data(), in.phi.data() };
+      return rtn;
+    }
+
+    //@}
+
+
+    /// Cluster @a particles, or their towers, at every radius
+    void calc(Particles particles) {
+      _cached.clear();
+      _inputs.resize(_towers.enabled() ? 2 : 1);
+      if (_towers.enabled()) {
+        RIVET_STAGE_TIMER("towers");
+        _setInputs(_inputs[1], _towers.towers(particles));
+      }
+      _setInputs(_inputs[0], std::move(particles));
+
+      _cseqs.assign(_radii.size(), shared_ptr<fastjet::ClusterSequence>());
+      _pjets.assign(_radii.size(), PseudoJets());
+      // Nothing to cluster: no jets at any radius
+      if (_inputs[0].particles.empty()) return;
+      if (_alg == FastJets::CAM) {
+        // One C/A clustering per input set at its largest radius, every
+        // radius read off its history
+        for (size_t is = 0; is < _inputs.size(); ++is) {
+          double rmax = 0;
+          for (size_t iR = 0; iR < _radii.size(); ++iR)
+            if (_inputSet(iR) == is) rmax = std::max(rmax, _radii[iR]);
+          if (rmax == 0) continue;
+          const fastjet::JetDefinition jdef(fastjet::cambridge_algorithm, rmax, fastjet::E_scheme);
+          shared_ptr<fastjet::ClusterSequence> cs;
+          {
+            RIVET_STAGE_TIMER("C/A clustering");
+            cs = make_shared<fastjet::ClusterSequence>(_inputs[is].pseudojets, jdef);
+          }
+          for (size_t iR = 0; iR < _radii.size(); ++iR) {
+            if (_inputSet(iR) != is) continue;
+            RIVET_STAGE_TIMER_R("C/A jets", iR);
+            _cseqs[iR] = cs;
+            _pjets[iR] = _radii[iR] < rmax ? cs->exclusive_jets(sqr(_radii[iR]/rmax)) : cs->inclusive_jets();
+          }
+        }
+      } else {
+        RIVET_STAGE_CONTEXT(timers);
+        forEachIndex(_pool, _radii.size(), [&](size_t iR) {
+            RIVET_STAGE_TIMER_IN(timers, "clustering", iR);
+            _cseqs[iR] = make_shared<fastjet::ClusterSequence>(_inputs[_inputSet(iR)].pseudojets, _jdefs[iR]);
+            _pjets[iR] = _cseqs[iR]->inclusive_jets();
+          });
+      }
+    }
+
+
+    /// @brief Take the jets at every radius from the jet cache event @a ev instead of clustering
+    ///
+    /// Only the jets the cache kept, above its pT threshold, are available.
+    /// Each jet's user index is its position in the cache.
+    void load(const CachedEvent& ev) {
+      if (ev.jets.size() != _radii.size()) throw UserError("Jet cache event has the wrong number of radii");
+      _cached = ev.jets;
+      _cseqs.assign(_radii.size(), shared_ptr<fastjet::ClusterSequence>());
+      _pjets.assign(_radii.size(), PseudoJets());
+      for (size_t iR = 0; iR < _radii.size(); ++iR) {
+        const CachedJets& cj = _cached[iR];
+        for (size_t i = 0; i < cj.size(); ++i) {
+          PseudoJet pj = fastjet::PtYPhiM(cj.pt[i], cj.y[i], cj.phi[i], cj.m[i]);
+          pj.set_user_index(i);
+          _pjets[iR].push_back(pj);
+        }
+      }
+    }
+
+
+  protected:
+
+    /// One set of clustering inputs, with their kinematics as arrays for the constituent views
+    struct Inputs {
+      Particles particles;
+      PseudoJets pseudojets;
+      vector<double> pt, eta, phi;
+    };
+
+    /// Index in _inputs of the inputs clustered at radius index @a iR
+    size_t _inputSet(size_t iR) const {
+      return _towers.enabled() && _radii[iR] >= _towers.rmin ? 1 : 0;
+    }
+
+    /// The maxJetPtBound() of jets clustered from @a particles
+    double _maxJetPtBound(const Particles& particles) const {
+      const double rmax = *max_element(_radii.begin(), _radii.end());
+      // Rapidity strips of R_max/4 (anything beyond |y| = YGRID goes in the
+      // end strips), so five empty strips in a row are a gap wider than R_max
+      static const double YGRID = 10;
+      static const size_t NPHI = 32, NGAP = 5;
+      const double ywidth = rmax/4;
+      const size_t ny = size_t(std::ceil(2*YGRID/ywidth));
+      vector<double> px(ny*NPHI, 0), py(ny*NPHI, 0), spt(ny*NPHI, 0);
+      vector<size_t> ycount(ny, 0);
+      for (const Particle& p : particles) {
+        const FourMomentum& mom = p.momentum();
+        const double y = std::min(std::max(mom.rapidity(), -YGRID), YGRID);
+        const size_t iy = std::min(size_t((y + YGRID)/ywidth), ny-1);
+        const size_t iphi = std::min(size_t(mom.phi(ZERO_2PI) / (2*M_PI) * NPHI), NPHI-1);
+        const size_t ic = iy*NPHI + iphi;
+        px[ic] += mom.px();
+        py[ic] += mom.py();
+        spt[ic] += mom.pT();
+        ycount[iy] += 1;
+      }
+
+      double rtn = 0;
+      vector<double> rpx(NPHI), rpy(NPHI), rspt(NPHI);
+      size_t iy = 0;
+      while (iy < ny) {
+        // Next rapidity region: occupied strips up to a gap of NGAP empty ones
+        while (iy < ny && ycount[iy] == 0) ++iy;
+        if (iy == ny) break;
+        std::fill(rpx.begin(), rpx.end(), 0);
+        std::fill(rpy.begin(), rpy.end(), 0);
+        std::fill(rspt.begin(), rspt.end(), 0);
+        size_t nempty = 0;
+        for (; iy < ny && nempty < NGAP; ++iy) {
+          nempty = ycount[iy] == 0 ? nempty+1 : 0;
+          for (size_t k = 0; k < NPHI; ++k) {
+            rpx[k] += px[iy*NPHI + k];
+            rpy[k] += py[iy*NPHI + k];
+            rspt[k] += spt[iy*NPHI + k];
+          }
+        }
+        // A half-plane starting in phi bin b covers bins b+1 ... b+NPHI/2-1
+        // and parts of bins b and b+NPHI/2
+        for (size_t b = 0; b < NPHI; ++b) {
+          double sx = 0, sy = 0;
+          for (size_t k = 1; k < NPHI/2; ++k) {
+            sx += rpx[(b+k) % NPHI];
+            sy += rpy[(b+k) % NPHI];
+          }
+          rtn = std::max(rtn, std::sqrt(sx*sx + sy*sy) + rspt[b] + rspt[(b + NPHI/2) % NPHI]);
+        }
+      }
+      return rtn;
+    }
+
+    /// Fill @a in from the particles @a ps
+    static void _setInputs(Inputs& in, Particles ps) {
+      in.particles = std::move(ps);
+      const Particles& particles = in.particles;
+      in.pseudojets.clear();
+      in.pt.clear(); in.eta.clear(); in.phi.clear();
+      in.pseudojets.reserve(particles.size());
+      for (size_t i = 0; i < particles.size(); ++i) {
+        PseudoJet pj = particles[i].pseudojet();
+        pj.set_user_index(i);
+        in.pseudojets.push_back(pj);
+        in.pt.push_back(pj.pt());
+        in.eta.push_back(pj.eta());
+        in.phi.push_back(pj.phi());
+      }
+    }
+
+    /// Make a Rivet jet, with constituents, from a PseudoJet at radius index @a iR
+    Jet _mkJet(size_t iR, const PseudoJet& pj) const {
+      Particles constituents;
+      if (!_cached.empty()) {
+        // Cached constituents, as massless pid 0 particles
+        const CachedJets& cj = _cached[iR];
+        if (!cj.hasConstituents()) return Jet(pj, constituents);
+        for (uint32_t k = cj.offsets[pj.user_index()]; k < cj.offsets[pj.user_index()+1]; ++k)
+          constituents.push_back(Particle(0, FourMomentum(cj.cpt[k]*std::cosh(cj.ceta[k]), cj.cpt[k]*std::cos(cj.cphi[k]),
+                                                          cj.cpt[k]*std::sin(cj.cphi[k]), cj.cpt[k]*std::sinh(cj.ceta[k]))));
+        return Jet(pj, constituents);
+      }
+      const Particles& inputs = _inputs[_inputSet(iR)].particles;
+      for (const PseudoJet& c : _cseqs[iR]->constituents(pj))
+        constituents.push_back(inputs[c.user_index()]);
+      return Jet(pj, constituents);
+    }
+
+    /// @brief Add the input indices of the particles clustered into history entry @a ih
+    ///
+    /// Inputs are the first entries of the history, in input order, so the
+    /// leaves' history indices are their particle indices.
+    static void _addConstituents(const fastjet::ClusterSequence& cs, int ih, vector<int>& indices) {
+      const fastjet::ClusterSequence::history_element& h = cs.history()[ih];
+      if (h.parent1 == fastjet::ClusterSequence::InexistentParent) {
+        indices.push_back(ih);
+        return;
+      }
+      _addConstituents(cs, h.parent1, indices);
+      _addConstituents(cs, h.parent2, indices);
+    }
+
+
+    /// @name Configuration
+    //@{
+    FastJets::JetAlgName _alg;
+    vector<double> _radii;
+    vector<fastjet::JetDefinition> _jdefs;
+    TowerGrid _towers;
+    shared_ptr<WorkerPool> _pool;
+    //@}
+
+    /// @name Results of the last clustering
+    //@{
+    vector<Inputs> _inputs;
+    vector< shared_ptr<fastjet::ClusterSequence> > _cseqs;
+    vector<PseudoJets> _pjets;
+    vector<CachedJets> _cached;
+    //@}
+
+  };
+
+
+
+  /// @brief Jets of one algorithm at several radii, from a single projection
+  ///
+  /// Replaces a set of FastJets projections which differ only in R. The
+  /// final-state selection and muon/invisible filtering are done once per
+  /// event and the clustering at every radius is a MultiRadiusClustering.
+  ///
+  /// @note No heavy-flavour or tau ghost tagging is done: the jets carry
+  /// their constituents but no tags.
+  class MultiRadiusJets : public Projection, public MultiRadiusClustering {
+  public:
+
+    /// Constructor from a final state, a jet algorithm and a list of radii
+    MultiRadiusJets(const FinalState& fs, FastJets::JetAlgName alg, const vector<double>& radii,
+                    JetAlg::MuonsStrategy usemuons=JetAlg::ALL_MUONS,
+                    JetAlg::InvisiblesStrategy useinvis=JetAlg::NO_INVISIBLES)
+      : MultiRadiusClustering(alg, radii),
+        _useMuons(usemuons), _useInvisibles(useinvis), _hasExcluded(false), _minJetPt(0), _belowMinJetPt(false)
+    {
+      setName("MultiRadiusJets");
+      declare(fs, "FS");
+    }
+
+    /// @brief Constructor from a final state without the particles of @a excluded
+    ///
+    /// Equivalent to clustering a VetoedFinalState of @a fs vetoing
+    /// @a excluded, such as a ZFinder's remainingFinalState(), but the
+    /// excluded particles, usually a handful, are skipped while the inputs
+    /// are selected instead of in a copy of the whole final state.
+    MultiRadiusJets(const FinalState& fs, const FinalState& excluded, FastJets::JetAlgName alg, const vector<double>& radii,
+                    JetAlg::MuonsStrategy usemuons=JetAlg::ALL_MUONS,
+                    JetAlg::InvisiblesStrategy useinvis=JetAlg::NO_INVISIBLES)
+      : MultiRadiusClustering(alg, radii),
+        _useMuons(usemuons), _useInvisibles(useinvis), _hasExcluded(true), _minJetPt(0), _belowMinJetPt(false)
+    {
+      setName("MultiRadiusJets");
+      declare(fs, "FS");
+      declare(excluded, "Excluded");
+    }
+
+    /// Clone on the heap
+    DEFAULT_RIVET_PROJ_CLONE(MultiRadiusJets);
+
+
+    /// @brief Skip the clustering of events in which no jet can reach @a ptmin
+    ///
+    /// The inputs selected for the clustering are checked against
+    /// maxJetPtBound() first; if the bound is below @a ptmin there are no
+    /// jets at any radius and belowMinJetPt() is true.
+    void setMinJetPt(double ptmin) { _minJetPt = ptmin; }
+
+    /// Whether the last event was not clustered, as no jet could reach the setMinJetPt() threshold
+    bool belowMinJetPt() const { return _belowMinJetPt; }
+
+
+    /// @brief The subset of final-state particles @a fsparticles which get clustered
+    ///
+    /// Applies the invisibles and muons strategies and leaves out the
+    /// particles of @a excluded, matched by generator particle, in a single
+    /// pass. Needs the particles' generator record for the from-decay checks.
+    Particles selectInputs(const Particles& fsparticles, const Particles& excluded=Particles()) const {
+      Particles rtn;
+      rtn.reserve(fsparticles.size());
+      for (const Particle& p : fsparticles) {
+        if (_useInvisibles == JetAlg::NO_INVISIBLES && !p.isVisible()) continue;
+        if (_useInvisibles == JetAlg::DECAY_INVISIBLES && !(p.isVisible() || p.fromDecay())) continue;
+        if (_useMuons == JetAlg::DECAY_MUONS && p.abspid() == PID::MUON && !p.fromDecay()) continue;
+        if (_useMuons == JetAlg::NO_MUONS && p.abspid() == PID::MUON) continue;
+        if (!excluded.empty() &&
+            std::any_of(excluded.begin(), excluded.end(), [&](const Particle& x) { return x.genParticle() == p.genParticle(); }))
+          continue;
+        rtn.push_back(p);
+      }
+      return rtn;
+    }
+
+
+  protected:
+
+    /// Select the input particles and cluster them at every radius
+    void project(const Event& e) {
+      const Particles& fsparticles = applyProjection<FinalState>(e, "FS").particles();
+      const Particles& excluded = _hasExcluded ? applyProjection<FinalState>(e, "Excluded").particles() : Particles();
+      Particles inputs;
+      {
+        RIVET_STAGE_TIMER("jet inputs");
+        inputs = selectInputs(fsparticles, excluded);
+      }
+      _belowMinJetPt = false;
+      if (_minJetPt > 0) {
+        RIVET_STAGE_TIMER("jet pT bound");
+        _belowMinJetPt = maxJetPtBound(inputs) < _minJetPt;
+      }
+      if (_belowMinJetPt) calc(Particles());
+      else calc(std::move(inputs));
+    }
+
+    /// Compare projections
+    int compare(const Projection& p) const {
+      const MultiRadiusJets& other = dynamic_cast<const MultiRadiusJets&>(p);
+      if (_hasExcluded != other._hasExcluded) return UNDEFINED;
+      if (_hasExcluded && mkNamedPCmp(other, "Excluded") != EQUIVALENT) return UNDEFINED;
+      return mkNamedPCmp(other, "FS") ||
+        cmp(_alg, other._alg) || cmp(_radii, other._radii) ||
+        cmp(_towers.dy, other._towers.dy) || cmp(_towers.dphi, other._towers.dphi) || cmp(_towers.rmin, other._towers.rmin) ||
+        cmp(_useMuons, other._useMuons) || cmp(_useInvisibles, other._useInvisibles) ||
+        cmp(_minJetPt, other._minJetPt);
+    }
+
+
+  private:
+
+    /// @name Input selection
+    //@{
+    JetAlg::MuonsStrategy _useMuons;
+    JetAlg::InvisiblesStrategy _useInvisibles;
+    bool _hasExcluded;
+    //@}
+
+    /// Clustering threshold, and whether the last event was below it
+    double _minJetPt;
+    bool _belowMinJetPt;
+
+  };
+
+
+
+  /// @brief Selected jets at every radius of a MultiRadiusJets, sorted by decreasing pT
+  ///
+  /// The jets carry no constituents. Analyses which make the same selection
+  /// on the same jets share one instance, so the cut and sort are done only
+  /// once per event between them.
+  class MultiRadiusJetsByPt : public Projection {
+  public:
+
+    /// Keep every selected jet
+    static const size_t ALL = size_t(-1);
+
+    /// Constructor from the jets, the selection cut and the number of hardest jets to keep
+    MultiRadiusJetsByPt(const MultiRadiusJets& jets, const Cut& c, size_t nmax=ALL)
+      : _cut(c), _nmax(nmax)
+    {
+      setName("MultiRadiusJetsByPt");
+      declare(jets, "Jets");
+    }
+
+    /// Clone on the heap
+    DEFAULT_RIVET_PROJ_CLONE(MultiRadiusJetsByPt);
+
+
+    /// Number of radii
+    size_t numRadii() const { return _jets.size(); }
+
+    /// Selected jets at radius index @a iR, sorted by decreasing pT
+    const Jets& jets(size_t iR) const { return _jets[iR]; }
+
+    /// Selected jets at every radius, indexed by radius index
+    const vector<Jets>& jetsByRadius() const { return _jets; }
+
+    /// Selected jets at every radius of @a mrj, for use away from the projection system
+    static vector<Jets> select(const MultiRadiusClustering& mrj, const Cut& c, size_t nmax=ALL) {
+      vector<Jets> rtn(mrj.numRadii());
+      for (size_t iR = 0; iR < mrj.numRadii(); ++iR)
+        rtn[iR] = nmax == ALL ? mrj.lightJetsByPt(iR, c) : mrj.hardestJets(iR, nmax, c);
+      return rtn;
+    }
+
+
+  protected:
+
+    /// Select the jets at every radius
+    void project(const Event& e) {
+      const MultiRadiusJets& mrj = applyProjection<MultiRadiusJets>(e, "Jets");
+      RIVET_STAGE_TIMER("jet selection");
+      _jets = select(mrj, _cut, _nmax);
+    }
+
+    /// Compare projections
+    int compare(const Projection& p) const {
+      const MultiRadiusJetsByPt& other = dynamic_cast<const MultiRadiusJetsByPt&>(p);
+      const int jcmp = mkNamedPCmp(other, "Jets") || cmp(_nmax, other._nmax);
+      if (jcmp != EQUIVALENT) return jcmp;
+      return _cut == other._cut ? EQUIVALENT : UNDEFINED;
+    }
+
+
+  private:
+
+    Cut _cut;
+    size_t _nmax;
+    vector<Jets> _jets;
+
+  };
+
+
+}
+
+#endif
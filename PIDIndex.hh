@@ -0,0 +1,84 @@
+// -*- C++ -*-
+#ifndef RIVET_PIDIndex_HH
+#define RIVET_PIDIndex_HH
+
+#include "Rivet/Projection.hh"
+#include "Rivet/Particle.hh"
+#include "StageTimers.hh"
+#include <unordered_map>
+
+namespace Rivet {
+
+
+  /// @brief Generator-record particles of each event indexed by PDG ID
+  ///
+  /// The record is walked once per event, the first time any analysis
+  /// applies the projection; every analysis of the job shares the one
+  /// index. Lookups then cost as much as the particles they return, not a
+  /// walk of the whole record with its shower history.
+  class PIDIndex : public Projection {
+  public:
+
+    PIDIndex() {
+      setName("PIDIndex");
+    }
+
+    /// Clone on the heap
+    DEFAULT_RIVET_PROJ_CLONE(PIDIndex);
+
+
+    /// Whether the record has any particle with PDG ID @a pid, and so a last copy of one
+    bool contains(PdgId pid) const {
+      const auto found = _index.find(pid);
+      return found != _index.end() && !found->second.empty();
+    }
+
+    /// @brief Last copies of the particles with PDG ID @a pid, in record order
+    ///
+    /// As event.allParticles(lastParticleWith(Cuts::pid == pid)): a
+    /// particle is a last copy if none of its children has the same ID.
+    Particles lastWith(PdgId pid) const {
+      Particles rtn;
+      const auto found = _index.find(pid);
+      if (found == _index.end()) return rtn;
+      for (const GenParticle* gp : found->second) {
+        bool last = true;
+        const GenVertex* dv = gp->end_vertex();
+        if (dv) {
+          for (GenVertex::particles_out_const_iterator c = dv->particles_out_const_begin(); c != dv->particles_out_const_end(); ++c)
+            if ((*c)->pdg_id() == pid) { last = false; break; }
+        }
+        if (last) rtn.push_back(Particle(gp));
+      }
+      return rtn;
+    }
+
+
+  protected:
+
+    /// Index the generator record of @a e
+    void project(const Event& e) {
+      RIVET_STAGE_TIMER("PID index");
+      // Keep the vectors' storage from event to event
+      for (auto& entry : _index) entry.second.clear();
+      const GenEvent* ge = e.genEvent();
+      for (GenEvent::particle_const_iterator p = ge->particles_begin(); p != ge->particles_end(); ++p)
+        _index[(*p)->pdg_id()].push_back(*p);
+    }
+
+    /// Compare projections: there is only one index
+    int compare(const Projection&) const {
+      return EQUIVALENT;
+    }
+
+
+  private:
+
+    std::unordered_map< PdgId, vector<const GenParticle*> > _index;
+
+  };
+
+
+}
+
+#endif
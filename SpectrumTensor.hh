@@ -0,0 +1,199 @@
+// -*- C++ -*-
+#ifndef RIVET_SpectrumTensor_HH
+#define RIVET_SpectrumTensor_HH
+
+#include "Rivet/Exceptions.hh"
+#include "YODA/Histo1D.hh"
+#include <algorithm>
+#include <vector>
+
+namespace Rivet {
+
+
+  /// @brief Bin finding on a fixed list of edges
+  ///
+  /// A table with one cell per smallest bin width gives the bin at the start
+  /// of each cell. A value is then at most one bin away from the table
+  /// entry for its cell, which two comparisons correct, so a lookup costs
+  /// no search. Very uneven binnings fall back to a binary search.
+  class BinLookup {
+  public:
+
+    /// Default constructor, for no bins
+    BinLookup() : _lo(0), _hi(0), _invstep(0) {  }
+
+    /// Constructor from increasing bin edges
+    explicit BinLookup(const std::vector<double>& edges)
+      : _edges(edges), _lo(0), _hi(0), _invstep(0)
+    {
+      if (_edges.size() < 2) return;
+      _lo = _edges.front();
+      _hi = _edges.back();
+      double minwidth = _hi - _lo;
+      for (size_t i = 0; i+1 < _edges.size(); ++i) minwidth = std::min(minwidth, _edges[i+1] - _edges[i]);
+      const double ncells = (_hi - _lo) / minwidth;
+      if (ncells > MAX_CELLS) return;
+      _invstep = 1/minwidth;
+      for (size_t c = 0; c <= size_t(ncells); ++c) {
+        const double x = _lo + c*minwidth;
+        _table.push_back(std::upper_bound(_edges.begin(), _edges.end()-1, x) - _edges.begin() - 1);
+      }
+    }
+
+    /// Number of bins
+    int numBins() const { return _edges.empty() ? 0 : _edges.size() - 1; }
+
+    /// Bin edges
+    const std::vector<double>& edges() const { return _edges; }
+
+    /// Index of the bin containing @a x: -1 below the first edge, numBins() at or above the last
+    int index(double x) const {
+      if (!(x >= _lo)) return -1;
+      if (x >= _hi) return numBins();
+      if (_table.empty())
+        return std::upper_bound(_edges.begin(), _edges.end(), x) - _edges.begin() - 1;
+      const size_t c = std::min(size_t((x - _lo) * _invstep), _table.size()-1);
+      int i = _table[c];
+      // Correct for the cell containing an edge, and for rounding at cell boundaries
+      i += (x >= _edges[i+1]);
+      i -= (x < _edges[i]);
+      return i;
+    }
+
+
+  private:
+
+    static constexpr double MAX_CELLS = 16384;
+
+    std::vector<double> _edges;
+    double _lo, _hi, _invstep;
+    std::vector<int> _table;
+
+  };
+
+
+
+  /// @brief Weighted spectra for a grid of radii and rapidity slices, in one flat array
+  ///
+  /// Accumulates the same moments as a YODA Histo1D, for every (radius,
+  /// slice) pair, in one contiguous block indexed by radius, then slice,
+  /// then bin. Each slice has its own binning and its own underflow and
+  /// overflow; values outside the slices are dropped, as in a
+  /// BinnedHistogram. unpack() writes one (radius, slice) spectrum into a
+  /// Histo1D with the same binning, once at the end of the run.
+  class SpectrumTensor {
+  public:
+
+    /// Default constructor, for no bins
+    SpectrumTensor() : _nr(0), _stride(0) {  }
+
+    /// Constructor from the number of radii, the slice edges and each slice's bin edges
+    SpectrumTensor(size_t nr, const std::vector<double>& sliceedges, const std::vector< std::vector<double> >& binedges)
+      : _nr(nr), _slices(sliceedges), _stride(0)
+    {
+      if (binedges.size() != size_t(_slices.numBins()))
+        throw UserError("SpectrumTensor needs one set of bin edges per slice");
+      for (const std::vector<double>& edges : binedges) {
+        _bins.push_back(BinLookup(edges));
+        _offsets.push_back(_stride);
+        _stride += _bins.back().numBins() + 2; //< plus underflow and overflow
+      }
+      _cells.assign(_nr * _stride, Cell());
+    }
+
+
+    /// Number of radii
+    size_t numRadii() const { return _nr; }
+
+    /// Number of slices
+    size_t numSlices() const { return _bins.size(); }
+
+
+    /// Fill @a x with weight @a w into the slice containing @a s, at radius index @a iR
+    void fill(size_t iR, double s, double x, double w) {
+      const int is = _slices.index(s);
+      if (is < 0 || is >= _slices.numBins()) return;
+      fillSlice(iR, is, x, w);
+    }
+
+    /// Fill @a x with weight @a w into slice @a is at radius index @a iR
+    void fillSlice(size_t iR, size_t is, double x, double w) {
+      const int ib = _bins[is].index(x);
+      Cell& c = _cells[iR*_stride + _offsets[is] + ib + 1];
+      c.n += 1;
+      c.sumw += w;
+      c.sumw2 += w*w;
+      c.sumwx += w*x;
+      c.sumwx2 += w*x*x;
+    }
+
+
+    /// Zero every bin
+    void reset() { std::fill(_cells.begin(), _cells.end(), Cell()); }
+
+    /// Add the contents of @a other, which must have the same binning
+    SpectrumTensor& operator += (const SpectrumTensor& other) {
+      for (size_t i = 0; i < _cells.size(); ++i) {
+        _cells[i].n += other._cells[i].n;
+        _cells[i].sumw += other._cells[i].sumw;
+        _cells[i].sumw2 += other._cells[i].sumw2;
+        _cells[i].sumwx += other._cells[i].sumwx;
+        _cells[i].sumwx2 += other._cells[i].sumwx2;
+      }
+      return *this;
+    }
+
+
+    /// Add the spectrum in slice @a is at radius index @a iR to @a h, which must have the slice's binning
+    void unpack(size_t iR, size_t is, YODA::Histo1D& h) const {
+      const std::vector<double>& edges = _bins[is].edges();
+      const Cell* cells = &_cells[iR*_stride + _offsets[is]];
+      const size_t nbins = _bins[is].numBins();
+      std::vector<YODA::HistoBin1D> bins;
+      YODA::Dbn1D total;
+      for (size_t ib = 0; ib < nbins; ++ib) {
+        bins.push_back(YODA::HistoBin1D(std::make_pair(edges[ib], edges[ib+1]), cells[ib+1].dbn()));
+        total += cells[ib+1].dbn();
+      }
+      const YODA::Dbn1D uflow = cells[0].dbn(), oflow = cells[nbins+1].dbn();
+      total += uflow;
+      total += oflow;
+      h += YODA::Histo1D(bins, total, uflow, oflow, h.path(), h.title());
+    }
+
+
+    /// Bin edges of @a h, which must have no gaps between bins
+    static std::vector<double> edgesOf(const YODA::Histo1D& h) {
+      std::vector<double> rtn;
+      for (const YODA::HistoBin1D& b : h.bins()) {
+        if (!rtn.empty() && b.xMin() != rtn.back())
+          throw UserError("SpectrumTensor needs contiguous bins: " + h.path() + " has a gap");
+        if (rtn.empty()) rtn.push_back(b.xMin());
+        rtn.push_back(b.xMax());
+      }
+      return rtn;
+    }
+
+
+  private:
+
+    /// Moments of the entries in one bin
+    struct Cell {
+      Cell() : n(0), sumw(0), sumw2(0), sumwx(0), sumwx2(0) {  }
+      YODA::Dbn1D dbn() const { return YODA::Dbn1D(n, sumw, sumw2, sumwx, sumwx2); }
+      double n, sumw, sumw2, sumwx, sumwx2;
+    };
+
+    size_t _nr;
+    BinLookup _slices;
+    std::vector<BinLookup> _bins;
+    std::vector<size_t> _offsets;
+    size_t _stride;
+    std::vector<Cell> _cells;
+
+  };
+
+
+}
+
+#endif
@@ -0,0 +1,400 @@
+// -*- C++ -*-
+#ifndef RIVET_StageTimers_HH
+#define RIVET_StageTimers_HH
+
+#include <string>
+#include <vector>
+
+#ifdef RIVET_STAGE_TIMERS
+#include "Rivet/Exceptions.hh"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#endif
+
+namespace Rivet {
+
+
+  /// @name Hot-path stage timers
+  ///
+  /// Compiled in only with -DRIVET_STAGE_TIMERS; otherwise every macro below
+  /// expands to nothing and StageTimers::report() returns no lines. Each
+  /// analysis owns a StageTimers, opens one event scope per event at the
+  /// top of analyze() (and one per deferred event in its shard workers), and
+  /// times named stages within it:
+  ///
+  ///   RIVET_STAGE_EVENT(_timers);
+  ///   { RIVET_STAGE_TIMER("bosons"); ... }
+  ///   ...
+  ///   for (const string& line : _timers.report(_radii)) MSG_INFO(line);
+  ///
+  /// Stages timed inside projections go to the analysis whose event scope
+  /// is open, so a projection shared by several analyses is charged to the
+  /// first one to apply it. RIVET_STAGE_TIMER_R charges a stage to a radius
+  /// index, and on the worker pool RIVET_STAGE_CONTEXT/RIVET_STAGE_TIMER_IN
+  /// hand the event scope of the calling thread to the tasks. A call site
+  /// looks its stage name up once, so the name must not change between
+  /// calls (a template's instantiations each have their own). The times of
+  /// one stage are summed over each event, and report() gives their mean,
+  /// median and 99th percentile per event, counting the events in which the
+  /// stage did not run as zero.
+  //@{
+
+
+#ifdef RIVET_STAGE_TIMERS
+
+  /// Per-analysis stage timings, collected per thread and merged in report()
+  class StageTimers {
+  public:
+
+    /// Maximum number of distinct stage names in the job
+    static const size_t MAXSTAGES = 32;
+
+    /// Radius indices beyond this are not timed
+    static const size_t MAXSLOTS = 63;
+
+    /// Slot of the stages not charged to a radius
+    static const size_t NOSLOT = size_t(-1);
+
+
+    /// Stage times summed over the current event, filled from any thread
+    class Accumulator {
+    public:
+
+      Accumulator() {
+        for (auto& ns : _ns) ns = 0;
+        for (auto& t : _touched) t = 0;
+      }
+
+      /// Add @a ns nanoseconds to stage @a stage at radius index @a slot
+      void add(size_t stage, size_t slot, uint64_t ns) {
+        const size_t bit = slot == NOSLOT ? MAXSLOTS : slot;
+        if (bit > MAXSLOTS) return;
+        _ns[stage*(MAXSLOTS+1) + bit].fetch_add(ns, std::memory_order_relaxed);
+        _touched[stage].fetch_or(uint64_t(1) << bit, std::memory_order_relaxed);
+      }
+
+    private:
+
+      friend class StageTimers;
+
+      /// Call @a fn(stage, slot, ns) for every stage timed since the last call, and reset
+      template <typename FN>
+      void _drain(FN fn) {
+        for (size_t is = 0; is < MAXSTAGES; ++is) {
+          uint64_t bits = _touched[is].exchange(0, std::memory_order_relaxed);
+          while (bits) {
+            const size_t bit = __builtin_ctzll(bits);
+            bits &= bits - 1;
+            fn(is, bit == MAXSLOTS ? NOSLOT : bit, _ns[is*(MAXSLOTS+1) + bit].exchange(0, std::memory_order_relaxed));
+          }
+        }
+      }
+
+      std::atomic<uint64_t> _ns[MAXSTAGES*(MAXSLOTS+1)];
+      std::atomic<uint64_t> _touched[MAXSTAGES];
+
+    };
+
+
+    /// Times one stage, from construction to destruction, into an accumulator (if any)
+    class Scope {
+    public:
+
+      Scope(Accumulator* acc, size_t stage, size_t slot)
+        : _acc(acc), _stage(stage), _slot(slot)
+      {
+        if (_acc) _start = std::chrono::steady_clock::now();
+      }
+
+      ~Scope() {
+        if (!_acc) return;
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start);
+        _acc->add(_stage, _slot, ns.count());
+      }
+
+      Scope(const Scope&) = delete;
+      Scope& operator = (const Scope&) = delete;
+
+    private:
+
+      Accumulator* _acc;
+      size_t _stage, _slot;
+      std::chrono::steady_clock::time_point _start;
+
+    };
+
+
+    /// @brief An event of @a timers, open from construction to destruction on this thread
+    ///
+    /// With @a newEvent false the scope times deferred work of an event
+    /// already counted, as in an event-parallel shard worker.
+    class EventScope {
+    public:
+
+      explicit EventScope(StageTimers& timers, bool newEvent=true)
+        : _timers(timers), _newEvent(newEvent)
+      {
+        ThreadState& ts = _threadState();
+        if (ts.depth == ts.stack.size()) ts.stack.emplace_back(new Accumulator);
+        _acc = ts.stack[ts.depth++].get();
+        _prev = ts.current;
+        ts.current = _acc;
+      }
+
+      /// Record the event's stage times
+      ~EventScope() {
+        ThreadState& ts = _threadState();
+        ts.current = _prev;
+        --ts.depth;
+        _timers._record(*_acc, _newEvent);
+      }
+
+      EventScope(const EventScope&) = delete;
+      EventScope& operator = (const EventScope&) = delete;
+
+    private:
+
+      StageTimers& _timers;
+      bool _newEvent;
+      Accumulator* _acc;
+      Accumulator* _prev;
+
+    };
+
+
+    StageTimers()
+      : _serial(_nextSerial()++)
+    {  }
+
+    StageTimers(const StageTimers&) = delete;
+    StageTimers& operator = (const StageTimers&) = delete;
+
+
+    /// Process-wide ID of the stage called @a name
+    static size_t stageId(const std::string& name) {
+      std::lock_guard<std::mutex> lock(_namesMutex());
+      std::vector<std::string>& names = _names();
+      for (size_t i = 0; i < names.size(); ++i)
+        if (names[i] == name) return i;
+      if (names.size() == MAXSTAGES) throw UserError("More than " + std::to_string(MAXSTAGES) + " timed stages");
+      names.push_back(name);
+      return names.size() - 1;
+    }
+
+    /// Accumulator of the event open on this thread, or null outside any event
+    static Accumulator* current() {
+      return _threadState().current;
+    }
+
+
+    /// @brief One line per stage and radius with its mean, p50 and p99 time per event
+    ///
+    /// Radius indices are labelled with @a radii. Call once the workers are
+    /// idle, in finalize() after any shard merge.
+    std::vector<std::string> report(const std::vector<double>& radii) const {
+      std::vector<std::string> rtn;
+      uint64_t nevents = 0;
+      std::map< std::pair<size_t, size_t>, Distribution > dists;
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (const auto& t : _perThread) {
+          nevents += t.second->nevents;
+          for (const auto& d : t.second->dists) dists[d.first] += d.second;
+        }
+      }
+      if (nevents == 0) return rtn;
+
+      char line[256];
+      std::snprintf(line, sizeof(line), "Stage timings over %llu events, in us per event: %10s %10s %10s",
+                    (unsigned long long) nevents, "mean", "p50", "p99");
+      rtn.push_back(line);
+      for (const auto& d : dists) {
+        std::string label;
+        {
+          std::lock_guard<std::mutex> lock(_namesMutex());
+          label = _names()[d.first.first];
+        }
+        if (d.first.second != NOSLOT) {
+          char r[32];
+          if (d.first.second < radii.size()) std::snprintf(r, sizeof(r), " R = %g", radii[d.first.second]);
+          else std::snprintf(r, sizeof(r), " radius #%zu", d.first.second);
+          label += r;
+        }
+        std::snprintf(line, sizeof(line), "  %-48s %10.2f %10.2f %10.2f", label.c_str(),
+                      1e-3*d.second.sum/nevents, 1e-3*d.second.quantile(0.5, nevents), 1e-3*d.second.quantile(0.99, nevents));
+        rtn.push_back(line);
+      }
+      return rtn;
+    }
+
+
+  private:
+
+    /// Per-event stage times, in eighth-of-an-octave bins
+    struct Distribution {
+      double sum = 0;
+      uint64_t n = 0;
+      std::vector<uint64_t> bins;
+
+      static size_t bin(uint64_t ns) {
+        if (ns < 8) return ns;
+        const size_t msb = 63 - __builtin_clzll(ns);
+        return 8*(msb - 2) + ((ns >> (msb - 3)) & 7);
+      }
+
+      static double centre(size_t b) {
+        if (b < 8) return b;
+        return (8 + (b & 7) + 0.5) * double(uint64_t(1) << (b/8 - 1));
+      }
+
+      void add(uint64_t ns) {
+        sum += ns;
+        n += 1;
+        const size_t b = bin(ns);
+        if (b >= bins.size()) bins.resize(b + 1, 0);
+        bins[b] += 1;
+      }
+
+      Distribution& operator += (const Distribution& other) {
+        sum += other.sum;
+        n += other.n;
+        if (other.bins.size() > bins.size()) bins.resize(other.bins.size(), 0);
+        for (size_t b = 0; b < other.bins.size(); ++b) bins[b] += other.bins[b];
+        return *this;
+      }
+
+      /// Quantile @a q over @a nevents events, those without an entry counting as zero
+      double quantile(double q, uint64_t nevents) const {
+        const double target = q*nevents;
+        double cum = nevents - n;
+        if (cum >= target) return 0;
+        for (size_t b = 0; b < bins.size(); ++b) {
+          cum += bins[b];
+          if (cum >= target) return centre(b);
+        }
+        return bins.empty() ? 0 : centre(bins.size() - 1);
+      }
+    };
+
+    /// What one thread recorded for this StageTimers
+    struct ThreadStats {
+      uint64_t nevents = 0;
+      std::map< std::pair<size_t, size_t>, Distribution > dists;
+    };
+
+    /// Open event scopes of a thread, innermost last, and their reusable accumulators
+    struct ThreadState {
+      std::vector< std::unique_ptr<Accumulator> > stack;
+      size_t depth = 0;
+      Accumulator* current = nullptr;
+      /// Last StageTimers recorded into from this thread, by serial
+      size_t lastSerial = size_t(-1);
+      ThreadStats* lastStats = nullptr;
+    };
+
+    static ThreadState& _threadState() {
+      static thread_local ThreadState ts;
+      return ts;
+    }
+
+    static std::atomic<size_t>& _nextSerial() {
+      static std::atomic<size_t> serial(0);
+      return serial;
+    }
+
+    static std::mutex& _namesMutex() {
+      static std::mutex m;
+      return m;
+    }
+
+    static std::vector<std::string>& _names() {
+      static std::vector<std::string> names;
+      return names;
+    }
+
+    /// This thread's statistics, created on first use
+    ThreadStats& _threadStats() {
+      ThreadState& ts = _threadState();
+      if (ts.lastSerial != _serial) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::unique_ptr<ThreadStats>& stats = _perThread[std::this_thread::get_id()];
+        if (!stats) stats.reset(new ThreadStats);
+        ts.lastSerial = _serial;
+        ts.lastStats = stats.get();
+      }
+      return *ts.lastStats;
+    }
+
+    /// Move the stage times of @a acc into this thread's statistics
+    void _record(Accumulator& acc, bool newEvent) {
+      ThreadStats& stats = _threadStats();
+      if (newEvent) stats.nevents += 1;
+      acc._drain([&](size_t stage, size_t slot, uint64_t ns) {
+          stats.dists[std::make_pair(stage, slot)].add(ns);
+        });
+    }
+
+    const size_t _serial;
+    mutable std::mutex _mutex;
+    std::unordered_map< std::thread::id, std::unique_ptr<ThreadStats> > _perThread;
+
+  };
+
+
+#define RIVET_STAGE_CONCAT2(A, B) A##B
+#define RIVET_STAGE_CONCAT(A, B) RIVET_STAGE_CONCAT2(A, B)
+
+  /// Open an event of the StageTimers @a TIMERS until the end of the block
+#define RIVET_STAGE_EVENT(TIMERS) \
+  const ::Rivet::StageTimers::EventScope RIVET_STAGE_CONCAT(_stageEvent, __LINE__)(TIMERS)
+
+  /// Open deferred work of an event already counted by @a TIMERS until the end of the block
+#define RIVET_STAGE_EVENT_PART(TIMERS) \
+  const ::Rivet::StageTimers::EventScope RIVET_STAGE_CONCAT(_stageEvent, __LINE__)(TIMERS, false)
+
+  /// Keep the event scope of this thread as @a VAR, for worker-pool tasks
+#define RIVET_STAGE_CONTEXT(VAR) \
+  ::Rivet::StageTimers::Accumulator* const VAR = ::Rivet::StageTimers::current()
+
+  /// Time the rest of the block as stage @a NAME at radius index @a SLOT of the event scope @a CTX
+#define RIVET_STAGE_TIMER_IN(CTX, NAME, SLOT) \
+  static const size_t RIVET_STAGE_CONCAT(_stageId, __LINE__) = ::Rivet::StageTimers::stageId(NAME); \
+  const ::Rivet::StageTimers::Scope RIVET_STAGE_CONCAT(_stageScope, __LINE__)(CTX, RIVET_STAGE_CONCAT(_stageId, __LINE__), SLOT)
+
+  /// Time the rest of the block as stage @a NAME at radius index @a SLOT
+#define RIVET_STAGE_TIMER_R(NAME, SLOT) \
+  RIVET_STAGE_TIMER_IN(::Rivet::StageTimers::current(), NAME, SLOT)
+
+  /// Time the rest of the block as stage @a NAME
+#define RIVET_STAGE_TIMER(NAME) \
+  RIVET_STAGE_TIMER_R(NAME, ::Rivet::StageTimers::NOSLOT)
+
+#else
+
+  /// Stage timers compiled out: no state and no report
+  class StageTimers {
+  public:
+    std::vector<std::string> report(const std::vector<double>&) const { return std::vector<std::string>(); }
+  };
+
+#define RIVET_STAGE_EVENT(TIMERS)
+#define RIVET_STAGE_EVENT_PART(TIMERS)
+#define RIVET_STAGE_CONTEXT(VAR)
+#define RIVET_STAGE_TIMER_IN(CTX, NAME, SLOT)
+#define RIVET_STAGE_TIMER_R(NAME, SLOT)
+#define RIVET_STAGE_TIMER(NAME)
+
+#endif
+
+  //@}
+
+
+}
+
+#endif
@@ -0,0 +1,75 @@
+// -*- C++ -*-
+#ifndef RIVET_StagedSelection_HH
+#define RIVET_StagedSelection_HH
+
+#include "Rivet/Event.hh"
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace Rivet {
+
+
+  /// @brief Cheap pre-selection stages, run in order before an analysis's expensive projections
+  ///
+  /// Each stage is a necessary condition for the event to survive the full
+  /// selection, so vetoing on the first failing stage never changes the
+  /// results, only how much work rejected events cost. Stages are added in
+  /// init() and checked at the top of analyze():
+  ///
+  ///   _stages.add("e+e- pair or Higgs", [this](const Event& e) { ... });
+  ///   ...
+  ///   if (!_stages.pass(event)) vetoEvent;
+  class StagedSelection {
+  public:
+
+    /// A stage: whether the event can still pass the full selection
+    typedef std::function<bool(const Event&)> Stage;
+
+    /// Append the stage @a stage, called @a name in the summary
+    void add(const std::string& name, const Stage& stage) {
+      _stages.push_back(Entry{ name, stage, 0 });
+    }
+
+    /// Whether there are any stages
+    bool empty() const { return _stages.empty(); }
+
+    /// Whether @a e passes every stage, stopping at the first one it fails
+    bool pass(const Event& e) {
+      ++_ntried;
+      for (Entry& s : _stages) {
+        if (!s.stage(e)) {
+          ++s.nrejected;
+          return false;
+        }
+      }
+      return true;
+    }
+
+    /// One line with the number of events rejected at each stage
+    std::string summary() const {
+      std::ostringstream ss;
+      ss << _ntried << " events pre-selected";
+      for (const Entry& s : _stages) ss << "; " << s.nrejected << " rejected by " << s.name;
+      return ss.str();
+    }
+
+
+  private:
+
+    struct Entry {
+      std::string name;
+      Stage stage;
+      size_t nrejected;
+    };
+
+    std::vector<Entry> _stages;
+    size_t _ntried = 0;
+
+  };
+
+
+}
+
+#endif
@@ -0,0 +1,152 @@
+// -*- C++ -*-
+#ifndef RIVET_WorkerPool_HH
+#define RIVET_WorkerPool_HH
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+#include <memory>
+#include <vector>
+#include <cstdlib>
+
+namespace Rivet {
+
+
+  /// @brief Fixed set of worker threads for data-parallel loops
+  ///
+  /// The only operation is run(n, fn), which calls fn(i) for every i in
+  /// [0, n) and returns when all calls have finished. The calling thread
+  /// takes tasks too, so a pool of size N uses N-1 extra threads. Tasks
+  /// must not touch Rivet projection or histogram state: apply projections
+  /// before the loop and fill histograms after it.
+  class WorkerPool {
+  public:
+
+    /// Constructor for a pool of @a nthreads threads, including the caller's
+    explicit WorkerPool(size_t nthreads)
+      : _ntasks(0), _next(0), _active(0), _generation(0), _stop(false)
+    {
+      for (size_t i = 1; i < nthreads; ++i)
+        _threads.push_back(std::thread([this] { _work(); }));
+    }
+
+    /// Stop and join the worker threads
+    ~WorkerPool() {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+      }
+      _wake.notify_all();
+      for (std::thread& t : _threads) t.join();
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator = (const WorkerPool&) = delete;
+
+    /// Number of threads taking tasks, including the caller
+    size_t size() const { return _threads.size() + 1; }
+
+    /// Call @a fn(i) for i in [0, @a n) and wait for all of them
+    ///
+    /// The first exception thrown by a task is rethrown here.
+    void run(size_t n, const std::function<void(size_t)>& fn) {
+      if (n == 0) return;
+      std::unique_lock<std::mutex> lock(_mutex);
+      // Late wakers from the previous batch must be out before it is replaced
+      _done.wait(lock, [this] { return _active == 0; });
+      _fn = &fn;
+      _ntasks = n;
+      _next = 0;
+      _error = nullptr;
+      ++_generation;
+      ++_active;
+      lock.unlock();
+      _wake.notify_all();
+      _take();
+      // Every task has been taken, so once no thread is taking any more they are all done
+      lock.lock();
+      _done.wait(lock, [this] { return _active == 0; });
+      _fn = nullptr;
+      if (_error) std::rethrow_exception(_error);
+    }
+
+
+  private:
+
+    /// Worker thread loop: wait for a new batch, take tasks until it is drained
+    void _work() {
+      size_t seen = 0;
+      while (true) {
+        {
+          std::unique_lock<std::mutex> lock(_mutex);
+          _wake.wait(lock, [&] { return _stop || _generation != seen; });
+          if (_stop) return;
+          seen = _generation;
+          ++_active;
+        }
+        _take();
+      }
+    }
+
+    /// Take and run tasks from the current batch until none are left, then deregister
+    void _take() {
+      while (true) {
+        const size_t i = _next.fetch_add(1);
+        if (i >= _ntasks) break;
+        try {
+          (*_fn)(i);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(_mutex);
+          if (!_error) _error = std::current_exception();
+        }
+      }
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (--_active == 0) _done.notify_all();
+    }
+
+
+    std::vector<std::thread> _threads;
+    std::mutex _mutex;
+    std::condition_variable _wake, _done;
+    const std::function<void(size_t)>* _fn = nullptr;
+    size_t _ntasks;
+    std::atomic<size_t> _next;
+    size_t _active;
+    size_t _generation;
+    bool _stop;
+    std::exception_ptr _error;
+
+  };
+
+
+  /// @brief Process-wide pool for per-radius work, or null if not enabled
+  ///
+  /// Parallel radius scans are opt-in: set RIVET_RADIUS_THREADS to the
+  /// number of threads to use (including the main one) to enable them.
+  inline std::shared_ptr<WorkerPool> radiusScanPool() {
+    static const std::shared_ptr<WorkerPool> pool = [] {
+      const char* env = std::getenv("RIVET_RADIUS_THREADS");
+      const long n = env ? std::atol(env) : 0;
+      return n > 1 ? std::make_shared<WorkerPool>(n) : std::shared_ptr<WorkerPool>();
+    }();
+    return pool;
+  }
+
+
+  /// Call @a fn(i) for i in [0, @a n), on @a pool if there is one, else in order
+  template <typename FN>
+  inline void forEachIndex(const std::shared_ptr<WorkerPool>& pool, size_t n, FN fn) {
+    if (pool && n > 1) {
+      pool->run(n, fn);
+    } else {
+      for (size_t i = 0; i < n; ++i) fn(i);
+    }
+  }
+
+
+}
+
+#endif
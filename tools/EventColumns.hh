@@ -0,0 +1,367 @@
+// -*- C++ -*-
+#ifndef RIVET_EventColumns_HH
+#define RIVET_EventColumns_HH
+
+#include "Rivet/Event.hh"
+#include "Rivet/Particle.hh"
+#include "HepMC/GenEvent.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Rivet {
+
+
+  /// @name Columnar event files
+  ///
+  /// A columnar event file holds only what the Z/H + jets and CMS_RAD
+  /// analyses read from an event: the final-state particles, the last Z and
+  /// H copies, and whether each particle comes from a hadron or tau decay.
+  /// It is binary, in native byte order, and is read through mmap without
+  /// any parsing:
+  ///
+  /// - a header: the magic "RIVEVTC1", the two beam PIDs and the two beam
+  ///   energies in GeV;
+  /// - chunks of up to EventColumnsWriter::CHUNK events: 'C', the numbers of
+  ///   events and particles and a spare word, then the event weight column,
+  ///   the particle px, py, pz and E columns in GeV, the event offset column
+  ///   (nevents+1 entries into the particle columns), the PID and status
+  ///   columns and the ancestry flag column, padded to 8 bytes so that every
+  ///   double column is aligned;
+  /// - a trailer: 'X' and the cross-section and its error in pb, or -1 if
+  ///   the input had none.
+  ///
+  /// Status is 1 for final-state particles and 2 for the Z and H bosons.
+  //@{
+
+
+  /// Ancestry flags of a particle in a columnar event file
+  enum EventColumnsFlag { FROM_HADRON = 1, FROM_TAU = 2 };
+
+
+  /// One event, as pointers into its particle columns
+  struct ColumnarEvent {
+    double weight;
+    size_t size;
+    const double *px, *py, *pz, *e;
+    const int32_t *pid, *status;
+    const uint8_t* flags;
+  };
+
+
+  /// @brief Call @a add(p, status) for each particle of @a event that is kept in columnar form
+  ///
+  /// These are the last Z copies and then the last H copies, with status
+  /// 2, each looked up on its own as in LH2017_ZHJETS::analyze() (an H
+  /// decaying to a Z is the last H even though it is not the last of the
+  /// Z and H copies), and the final-state particles. A last copy which is
+  /// itself in the final state, as in samples with a stable Z or H, is only
+  /// kept once, with status 1.
+  template <typename FN>
+  inline void forEachColumnarParticle(const Event& event, FN add) {
+    for (PdgId pid : { PdgId(PID::ZBOSON), PdgId(PID::HIGGS) }) {
+      for (const Particle& p : event.allParticles(lastParticleWith(Cuts::pid == pid)))
+        if (!p.genParticle() || p.genParticle()->status() != 1) add(p, 2);
+    }
+    for (const Particle& p : event.allParticles()) {
+      if (p.genParticle() && p.genParticle()->status() == 1) add(p, 1);
+    }
+  }
+
+
+  /// Ancestry flags of @a p
+  inline uint8_t columnarFlags(const Particle& p) {
+    return (p.fromHadron() ? FROM_HADRON : 0) | (p.fromTau() ? FROM_TAU : 0);
+  }
+
+
+  /// @brief Build @a ev as a HepMC event, in GeV
+  ///
+  /// Only the ancestry the flags record is rebuilt: particles from hadron
+  /// or tau decays hang off a placeholder status-2 pi0 or tau, so that
+  /// fromHadron(), fromTau() and fromDecay() give the original answers. A
+  /// negative @a xs means no cross-section.
+  inline void fillGenEvent(const ColumnarEvent& ev, const int32_t beamPids[2], const double beamEnergies[2],
+                           double xs, double xserr, HepMC::GenEvent& ge) {
+    ge.clear();
+    ge.use_units(HepMC::Units::GEV, HepMC::Units::MM);
+    ge.weights().push_back(ev.weight);
+    if (xs >= 0) {
+      HepMC::GenCrossSection gxs;
+      gxs.set_cross_section(xs, xserr);
+      ge.set_cross_section(gxs);
+    }
+
+    HepMC::GenVertex* vhard = new HepMC::GenVertex();
+    ge.add_vertex(vhard);
+    HepMC::GenParticle* b1 = new HepMC::GenParticle(HepMC::FourVector(0, 0, beamEnergies[0], beamEnergies[0]), beamPids[0], 4);
+    HepMC::GenParticle* b2 = new HepMC::GenParticle(HepMC::FourVector(0, 0, -beamEnergies[1], beamEnergies[1]), beamPids[1], 4);
+    vhard->add_particle_in(b1);
+    vhard->add_particle_in(b2);
+    ge.set_beam_particles(b1, b2);
+
+    // Placeholder decay vertices, by flags, made when first needed
+    auto placeholder = [&](HepMC::GenVertex* parent, int pid) {
+      HepMC::GenParticle* p = new HepMC::GenParticle(HepMC::FourVector(0, 0, 0, 0), pid, 2);
+      parent->add_particle_out(p);
+      HepMC::GenVertex* v = new HepMC::GenVertex();
+      v->add_particle_in(p);
+      ge.add_vertex(v);
+      return v;
+    };
+    HepMC::GenVertex* vdecay[4] = { vhard, 0, 0, 0 };
+    for (size_t k = 0; k < ev.size; ++k) {
+      const uint8_t f = ev.flags[k] & (FROM_HADRON | FROM_TAU);
+      if (!vdecay[f]) {
+        HepMC::GenVertex* vparent = vhard;
+        if (f == (FROM_HADRON | FROM_TAU)) {
+          if (!vdecay[FROM_HADRON]) vdecay[FROM_HADRON] = placeholder(vhard, 111);
+          vparent = vdecay[FROM_HADRON];
+        }
+        vdecay[f] = placeholder(vparent, f == FROM_HADRON ? 111 : 15);
+      }
+      vdecay[f]->add_particle_out(new HepMC::GenParticle(HepMC::FourVector(ev.px[k], ev.py[k], ev.pz[k], ev.e[k]),
+                                                         ev.pid[k], ev.status[k]));
+    }
+  }
+
+
+  /// Writes events to a columnar event file
+  class EventColumnsWriter {
+  public:
+
+    /// Number of events per chunk
+    static const size_t CHUNK = 4096;
+
+    /// Open @a path; the header is written with the first event's beams
+    explicit EventColumnsWriter(const string& path)
+      : _out(path.c_str(), std::ios::binary), _started(false), _xs(-1), _xserr(-1)
+    {
+      if (!_out) throw UserError("Could not open " + path + " for writing");
+      _offsets.push_back(0);
+    }
+
+    /// Add the event @a ge
+    void write(const HepMC::GenEvent& ge) {
+      const Event event(ge);
+      if (!_started) {
+        const ParticlePair beams = event.beams();
+        _header(beams.first.pid(), beams.second.pid(), beams.first.E()/GeV, beams.second.E()/GeV);
+      }
+      if (ge.cross_section()) {
+        _xs = ge.cross_section()->cross_section();
+        _xserr = ge.cross_section()->cross_section_error();
+      }
+
+      _weights.push_back(event.weight());
+      forEachColumnarParticle(event, [this](const Particle& p, int status) { _add(p, status); });
+      _offsets.push_back(_px.size());
+      if (_weights.size() == CHUNK) _flush();
+    }
+
+    /// Write the last chunk and the trailer
+    void finish() {
+      if (!_started) _header(0, 0, 0, 0);
+      _flush();
+      _write(uint32_t('X'));
+      _write(_xs);
+      _write(_xserr);
+      _out.close();
+    }
+
+
+  private:
+
+    void _header(int32_t pid1, int32_t pid2, double e1, double e2) {
+      _out.write("RIVEVTC1", 8);
+      _write(pid1); _write(pid2);
+      _write(e1); _write(e2);
+      _started = true;
+    }
+
+    void _add(const Particle& p, int status) {
+      _px.push_back(p.px()/GeV);
+      _py.push_back(p.py()/GeV);
+      _pz.push_back(p.pz()/GeV);
+      _e.push_back(p.E()/GeV);
+      _pid.push_back(p.pid());
+      _status.push_back(status);
+      _flags.push_back(columnarFlags(p));
+    }
+
+    void _flush() {
+      if (_weights.empty()) return;
+      _write(uint32_t('C'));
+      _write(uint32_t(_weights.size()));
+      _write(uint32_t(_px.size()));
+      _write(uint32_t(0));
+      _writeColumn(_weights);
+      _writeColumn(_px); _writeColumn(_py); _writeColumn(_pz); _writeColumn(_e);
+      _writeColumn(_offsets);
+      _writeColumn(_pid); _writeColumn(_status);
+      _writeColumn(_flags);
+      const size_t pad = (8 - ((_weights.size()+1)*4 + _px.size()*9) % 8) % 8;
+      _out.write("\0\0\0\0\0\0\0", pad);
+      _weights.clear(); _offsets.assign(1, 0);
+      _px.clear(); _py.clear(); _pz.clear(); _e.clear();
+      _pid.clear(); _status.clear(); _flags.clear();
+    }
+
+    template <typename T>
+    void _write(const T& x) {
+      _out.write(reinterpret_cast<const char*>(&x), sizeof(T));
+    }
+
+    template <typename T>
+    void _writeColumn(const vector<T>& c) {
+      _out.write(reinterpret_cast<const char*>(c.data()), c.size()*sizeof(T));
+    }
+
+    std::ofstream _out;
+    bool _started;
+    double _xs, _xserr;
+    vector<double> _weights;
+    vector<uint32_t> _offsets;
+    vector<double> _px, _py, _pz, _e;
+    vector<int32_t> _pid, _status;
+    vector<uint8_t> _flags;
+
+  };
+
+
+
+  /// @brief Reads a columnar event file through mmap
+  ///
+  /// Opening the file only walks the chunk headers; the events are read
+  /// straight from the mapped columns.
+  class EventColumnsReader {
+  public:
+
+    /// Map @a path and index its chunks
+    explicit EventColumnsReader(const string& path)
+      : _path(path), _data(0), _size(0), _xs(-1), _xserr(-1)
+    {
+      const int fd = ::open(path.c_str(), O_RDONLY);
+      struct stat st;
+      if (fd < 0 || ::fstat(fd, &st) != 0) throw UserError("Could not open " + path);
+      _size = st.st_size;
+      void* data = _size > 0 ? ::mmap(0, _size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+      ::close(fd);
+      if (data == MAP_FAILED) throw UserError("Could not map " + path);
+      _data = static_cast<const char*>(data);
+      ::madvise(data, _size, MADV_SEQUENTIAL);
+
+      if (_size < 32 || std::memcmp(_data, "RIVEVTC1", 8) != 0) _corrupt();
+      std::memcpy(_beamPids, _data + 8, sizeof(_beamPids));
+      std::memcpy(_beamEnergies, _data + 16, sizeof(_beamEnergies));
+      for (size_t pos = 32; ; ) {
+        const uint32_t tag = _at<uint32_t>(pos);
+        if (tag == 'X') {
+          _xs = _at<double>(pos + 4);
+          _xserr = _at<double>(pos + 12);
+          break;
+        }
+        if (tag != 'C') _corrupt();
+        Chunk c;
+        c.first = size();
+        c.nevents = _at<uint32_t>(pos + 4);
+        const size_t npart = _at<uint32_t>(pos + 8);
+        size_t col = pos + 16;
+        c.weights = _column<double>(col, c.nevents);
+        c.px = _column<double>(col, npart); c.py = _column<double>(col, npart);
+        c.pz = _column<double>(col, npart); c.e = _column<double>(col, npart);
+        c.offsets = _column<uint32_t>(col, c.nevents + 1);
+        c.pid = _column<int32_t>(col, npart); c.status = _column<int32_t>(col, npart);
+        c.flags = _column<uint8_t>(col, npart);
+        _chunks.push_back(c);
+        pos = col + (8 - col % 8) % 8;
+      }
+    }
+
+    ~EventColumnsReader() {
+      if (_data) ::munmap(const_cast<char*>(_data), _size);
+    }
+
+    EventColumnsReader(const EventColumnsReader&) = delete;
+    EventColumnsReader& operator=(const EventColumnsReader&) = delete;
+
+    /// Number of events
+    size_t size() const { return _chunks.empty() ? 0 : _chunks.back().first + _chunks.back().nevents; }
+
+    /// Beam PIDs and energies in GeV
+    pair<int, int> beamPids() const { return make_pair(_beamPids[0], _beamPids[1]); }
+    pair<double, double> beamEnergies() const { return make_pair(_beamEnergies[0], _beamEnergies[1]); }
+
+    /// Cross-section and its error in pb, negative if the input had none
+    double crossSection() const { return _xs; }
+    double crossSectionError() const { return _xserr; }
+
+    /// The columns of event @a i
+    ColumnarEvent event(size_t i) const {
+      if (i >= size()) throw UserError("Event " + toString(i) + " is beyond the end of " + _path);
+      // Every chunk but the last is full
+      const Chunk& c = _chunks[i / _chunks.front().nevents];
+      const size_t j = i - c.first, k = c.offsets[j];
+      const ColumnarEvent rtn = { c.weights[j], c.offsets[j+1] - k, c.px + k, c.py + k, c.pz + k, c.e + k,
+                              c.pid + k, c.status + k, c.flags + k };
+      return rtn;
+    }
+
+    /// Build event @a i as a HepMC event, in GeV
+    void fillGenEvent(size_t i, HepMC::GenEvent& ge) const {
+      Rivet::fillGenEvent(event(i), _beamPids, _beamEnergies, _xs, _xserr, ge);
+      ge.set_event_number(i);
+    }
+
+
+  private:
+
+    /// Contiguous events and their columns
+    struct Chunk {
+      size_t first, nevents;
+      const double* weights;
+      const uint32_t* offsets;
+      const double *px, *py, *pz, *e;
+      const int32_t *pid, *status;
+      const uint8_t* flags;
+    };
+
+    template <typename T>
+    T _at(size_t pos) const {
+      if (pos + sizeof(T) > _size) _corrupt();
+      T x;
+      std::memcpy(&x, _data + pos, sizeof(T));
+      return x;
+    }
+
+    /// The @a n entries of type T at @a pos, which is then advanced past them
+    template <typename T>
+    const T* _column(size_t& pos, size_t n) const {
+      if (pos + n*sizeof(T) > _size) _corrupt();
+      const T* rtn = reinterpret_cast<const T*>(_data + pos);
+      pos += n*sizeof(T);
+      return rtn;
+    }
+
+    void _corrupt() const { throw UserError("Corrupt or truncated event file " + _path); }
+
+    string _path;
+    const char* _data;
+    size_t _size;
+    int32_t _beamPids[2];
+    double _beamEnergies[2];
+    double _xs, _xserr;
+    vector<Chunk> _chunks;
+
+  };
+
+  //@}
+
+
+}
+
+#endif
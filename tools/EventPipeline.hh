@@ -0,0 +1,172 @@
+// -*- C++ -*-
+#ifndef RIVET_EventPipeline_HH
+#define RIVET_EventPipeline_HH
+
+#include "HepMC/GenEvent.h"
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+
+namespace Rivet {
+
+
+  /// @brief Bounded lock-free queue between one producer and one consumer thread
+  ///
+  /// push() waits while the queue is full and pop() while it is empty, so a
+  /// fast producer is held back to at most capacity() items ahead. Waiting
+  /// sleeps in short steps rather than spinning, so that idle decoders and
+  /// consumers leave their cores to the other jobs on the machine.
+  template <typename T>
+  class BoundedQueue {
+  public:
+
+    /// Constructor for a queue of at most @a capacity items
+    explicit BoundedQueue(size_t capacity)
+      : _slots(capacity), _head(0), _tail(0), _closed(false), _stop(false)
+    {  }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator = (const BoundedQueue&) = delete;
+
+    size_t capacity() const { return _slots.size(); }
+
+    /// Producer: add @a x, waiting for room; false if the consumer has stopped the queue
+    bool push(std::unique_ptr<T> x) {
+      const size_t tail = _tail.load(std::memory_order_relaxed);
+      while (tail - _head.load(std::memory_order_acquire) == _slots.size()) {
+        if (_stop.load(std::memory_order_relaxed)) return false;
+        _wait();
+      }
+      _slots[tail % _slots.size()] = std::move(x);
+      _tail.store(tail + 1, std::memory_order_release);
+      return true;
+    }
+
+    /// Producer: mark that no more items will come
+    void close() { _closed.store(true, std::memory_order_release); }
+
+    /// Consumer: take the next item, waiting for one; null once the queue is closed and empty
+    std::unique_ptr<T> pop() {
+      const size_t head = _head.load(std::memory_order_relaxed);
+      while (head == _tail.load(std::memory_order_acquire)) {
+        // Recheck after seeing the close, for an item pushed just before it
+        if (_closed.load(std::memory_order_acquire) && head == _tail.load(std::memory_order_acquire))
+          return std::unique_ptr<T>();
+        _wait();
+      }
+      std::unique_ptr<T> rtn = std::move(_slots[head % _slots.size()]);
+      _head.store(head + 1, std::memory_order_release);
+      return rtn;
+    }
+
+    /// Consumer: make any waiting or later push() give up
+    void stop() { _stop.store(true, std::memory_order_relaxed); }
+
+
+  private:
+
+    static void _wait() { std::this_thread::sleep_for(std::chrono::microseconds(20)); }
+
+    std::vector< std::unique_ptr<T> > _slots;
+    std::atomic<size_t> _head, _tail;
+    std::atomic<bool> _closed, _stop;
+
+  };
+
+
+
+  /// @brief Events decoded on background threads, handed out in order
+  ///
+  /// With N decoder threads, thread d decodes events d, d+N, d+2N, ... into
+  /// its own BoundedQueue, and next() takes them round-robin, so the events
+  /// come out in input order and at most N x depth of them are held at
+  /// once. A sequential source such as a HepMC stream needs N = 1; a
+  /// random-access one such as an EventColumnsReader can use more.
+  class EventPipeline {
+  public:
+
+    /// Decode event @a i into the given event, or return false past the last event
+    typedef std::function<bool(size_t i, HepMC::GenEvent&)> Decoder;
+
+    /// Start @a ndecoders threads running @a decode, each at most @a depth events ahead
+    EventPipeline(size_t ndecoders, size_t depth, const Decoder& decode)
+      : _decode(decode), _next(0), _done(false)
+    {
+      for (size_t d = 0; d < ndecoders; ++d)
+        _queues.push_back(std::unique_ptr< BoundedQueue<HepMC::GenEvent> >(new BoundedQueue<HepMC::GenEvent>(depth)));
+      _errors.resize(ndecoders);
+      for (size_t d = 0; d < ndecoders; ++d)
+        _threads.push_back(std::thread([this, d] { _work(d); }));
+    }
+
+    /// Stop and join the decoder threads
+    ~EventPipeline() {
+      for (auto& q : _queues) q->stop();
+      for (std::thread& t : _threads) t.join();
+    }
+
+    EventPipeline(const EventPipeline&) = delete;
+    EventPipeline& operator = (const EventPipeline&) = delete;
+
+    /// @brief The next event in input order, or null after the last one
+    ///
+    /// An exception thrown by the decoder is rethrown here, in place of the
+    /// event it failed on.
+    std::unique_ptr<HepMC::GenEvent> next() {
+      if (_done) return std::unique_ptr<HepMC::GenEvent>();
+      const size_t d = _next++ % _queues.size();
+      std::unique_ptr<HepMC::GenEvent> rtn = _queues[d]->pop();
+      if (!rtn) {
+        _done = true;
+        if (_errors[d]) std::rethrow_exception(_errors[d]);
+      }
+      return rtn;
+    }
+
+
+  private:
+
+    /// Decoder thread loop for thread @a d
+    void _work(size_t d) {
+      BoundedQueue<HepMC::GenEvent>& q = *_queues[d];
+      try {
+        for (size_t i = d; ; i += _queues.size()) {
+          std::unique_ptr<HepMC::GenEvent> ge(new HepMC::GenEvent());
+          if (!_decode(i, *ge) || !q.push(std::move(ge))) break;
+        }
+      } catch (...) {
+        _errors[d] = std::current_exception();
+      }
+      q.close();
+    }
+
+
+    Decoder _decode;
+    std::vector< std::unique_ptr< BoundedQueue<HepMC::GenEvent> > > _queues;
+    std::vector<std::exception_ptr> _errors;
+    std::vector<std::thread> _threads;
+    size_t _next;
+    bool _done;
+
+  };
+
+
+  /// @brief Number of event decoder threads, 0 to decode on the analysis thread
+  ///
+  /// Pipelined input is opt-in: set RIVET_DECODE_THREADS to the number of
+  /// decoder threads to enable it.
+  inline size_t eventDecodeThreads() {
+    const char* env = std::getenv("RIVET_DECODE_THREADS");
+    const long n = env ? std::atol(env) : 0;
+    return n > 0 ? n : 0;
+  }
+
+
+}
+
+#endif
@@ -0,0 +1,277 @@
+// -*- C++ -*-
+#ifndef RIVET_EventRing_HH
+#define RIVET_EventRing_HH
+
+#include "EventColumns.hh"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <new>
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Rivet {
+
+
+  /// @name Shared-memory event rings
+  ///
+  /// A generator process on the same machine writes events into a ring of
+  /// fixed-size slots in POSIX shared memory, and the analysis process
+  /// reads them in place, with no text to write or parse. Rivet analyses
+  /// still need a HepMC event, so the consumer rebuilds one from each slot
+  /// with fillGenEvent(), as from a columnar event file. Each slot holds one event in the columnar layout
+  /// of the columnar event files: the weight and particle count, then the
+  /// px, py, pz and E, PID and status, and ancestry flag columns, each with
+  /// room for the ring's maximum number of particles. Producer and consumer
+  /// only share the slot head and tail counters, so there is no locking.
+  /// The consumer checks that the producer process is still alive while it
+  /// waits, so a producer killed before closing the ring is an error rather
+  /// than a hang, and so is a producer which destroyed its writer without
+  /// closing the ring, e.g. on an exception.
+  //@{
+
+
+  /// Control block at the start of the shared memory
+  struct EventRingHeader {
+    char magic[8];
+    uint32_t nslots, maxParticles;
+    uint64_t slotBytes;
+    int32_t beamPids[2];
+    /// Process ID of the producer
+    int32_t producerPid;
+    double beamEnergies[2];
+    /// Cross-section and its error in pb, negative if none, to be read after the ring is closed
+    double xs, xserr;
+    /// Events taken by the consumer, and written by the producer, on their own cache lines
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+    /// Set by the producer after its last event
+    std::atomic<uint32_t> closed;
+    /// Set by the producer if it stopped without closing the ring
+    std::atomic<uint32_t> aborted;
+  };
+
+  static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+                "Event rings need address-free atomics to work across processes");
+
+
+  /// Bytes per slot for events of up to @a maxParticles particles, rounded up to whole cache lines
+  inline size_t eventRingSlotBytes(size_t maxParticles) {
+    const size_t bytes = 16 + maxParticles*(4*sizeof(double) + 2*sizeof(int32_t) + 1);
+    return (bytes + 63)/64*64;
+  }
+
+
+  /// Writes events into a shared-memory ring, as the generator-side producer
+  class EventRingWriter {
+  public:
+
+    /// Create the ring @a name with @a nslots slots of up to @a maxParticles particles
+    EventRingWriter(const string& name, size_t nslots, size_t maxParticles)
+      : _name(name), _nevents(0)
+    {
+      ::shm_unlink(name.c_str());
+      const int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+      _size = sizeof(EventRingHeader) + nslots*eventRingSlotBytes(maxParticles);
+      if (fd < 0 || ::ftruncate(fd, _size) != 0) throw UserError("Could not create the shared-memory event ring " + name);
+      void* data = ::mmap(0, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      ::close(fd);
+      if (data == MAP_FAILED) throw UserError("Could not map the shared-memory event ring " + name);
+      _header = new (data) EventRingHeader();
+      _header->nslots = nslots;
+      _header->maxParticles = maxParticles;
+      _header->slotBytes = eventRingSlotBytes(maxParticles);
+      _header->producerPid = ::getpid();
+      _header->xs = _header->xserr = -1;
+      _header->head = _header->tail = 0;
+      _header->closed = 0;
+      _header->aborted = 0;
+      // The magic goes last: the consumer waits for it
+      std::atomic_thread_fence(std::memory_order_release);
+      std::memcpy(_header->magic, "RIVRING2", 8);
+    }
+
+    /// @brief Unmap the ring; the consumer removes it once it has read everything
+    ///
+    /// A ring which was not closed, e.g. as an exception unwinds the
+    /// producer, is marked as aborted rather than complete.
+    ~EventRingWriter() {
+      if (!_header->closed.load(std::memory_order_acquire)) _header->aborted.store(1, std::memory_order_release);
+      ::munmap(_header, _size);
+    }
+
+    EventRingWriter(const EventRingWriter&) = delete;
+    EventRingWriter& operator = (const EventRingWriter&) = delete;
+
+    /// Add the event @a ge, waiting for a free slot
+    void write(const HepMC::GenEvent& ge) {
+      const Event event(ge);
+      if (_nevents == 0) {
+        const ParticlePair beams = event.beams();
+        _header->beamPids[0] = beams.first.pid();
+        _header->beamPids[1] = beams.second.pid();
+        _header->beamEnergies[0] = beams.first.E()/GeV;
+        _header->beamEnergies[1] = beams.second.E()/GeV;
+      }
+      if (ge.cross_section()) {
+        _header->xs = ge.cross_section()->cross_section();
+        _header->xserr = ge.cross_section()->cross_section_error();
+      }
+
+      const uint64_t tail = _header->tail.load(std::memory_order_relaxed);
+      while (tail - _header->head.load(std::memory_order_acquire) == _header->nslots) _wait();
+      char* slot = reinterpret_cast<char*>(_header + 1) + (tail % _header->nslots)*_header->slotBytes;
+      const size_t max = _header->maxParticles;
+      double* weight = reinterpret_cast<double*>(slot);
+      uint32_t* n = reinterpret_cast<uint32_t*>(slot + 8);
+      double *px = weight + 2, *py = px + max, *pz = py + max, *e = pz + max;
+      int32_t *pid = reinterpret_cast<int32_t*>(e + max), *status = pid + max;
+      uint8_t* flags = reinterpret_cast<uint8_t*>(status + max);
+      *weight = event.weight();
+      *n = 0;
+      forEachColumnarParticle(event, [&](const Particle& p, int st) {
+          if (*n == max) throw UserError("Event with more than " + toString(max) + " particles for the event ring " + _name);
+          px[*n] = p.px()/GeV; py[*n] = p.py()/GeV; pz[*n] = p.pz()/GeV; e[*n] = p.E()/GeV;
+          pid[*n] = p.pid(); status[*n] = st; flags[*n] = columnarFlags(p);
+          ++*n;
+        });
+      _header->tail.store(tail + 1, std::memory_order_release);
+      ++_nevents;
+    }
+
+    /// Mark the end of the events
+    void close() {
+      _header->closed.store(1, std::memory_order_release);
+    }
+
+
+  private:
+
+    static void _wait() { std::this_thread::sleep_for(std::chrono::microseconds(20)); }
+
+    string _name;
+    size_t _size;
+    EventRingHeader* _header;
+    size_t _nevents;
+
+  };
+
+
+
+  /// @brief Reads events from a shared-memory ring, as the analysis-side consumer
+  ///
+  /// next() gives a view of the event in its slot, which stays valid until
+  /// release(); only then can the producer reuse the slot.
+  class EventRingReader {
+  public:
+
+    /// Open the ring @a name, waiting up to @a timeout seconds for the producer to create it
+    explicit EventRingReader(const string& name, double timeout=60)
+      : _name(name), _header(0), _size(0), _held(false)
+    {
+      const auto start = std::chrono::steady_clock::now();
+      while (true) {
+        const int fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+        struct stat st;
+        if (fd >= 0 && ::fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(EventRingHeader)) {
+          _size = st.st_size;
+          void* data = ::mmap(0, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+          ::close(fd);
+          if (data == MAP_FAILED) throw UserError("Could not map the shared-memory event ring " + name);
+          _header = static_cast<EventRingHeader*>(data);
+          if (std::memcmp(_header->magic, "RIVRING2", 8) == 0) break;
+          ::munmap(data, _size);
+          _header = 0;
+        } else if (fd >= 0) {
+          ::close(fd);
+        }
+        if (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > timeout)
+          throw UserError("No shared-memory event ring " + name + " appeared");
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      _checkProducer();
+    }
+
+    /// Unmap and remove the ring
+    ~EventRingReader() {
+      ::munmap(_header, _size);
+      ::shm_unlink(_name.c_str());
+    }
+
+    EventRingReader(const EventRingReader&) = delete;
+    EventRingReader& operator = (const EventRingReader&) = delete;
+
+    /// @brief Wait for the next event and view it in @a ev, or return false once the producer has closed the ring
+    ///
+    /// Throws a UserError once the events run out if the producer aborted
+    /// the ring or exited without closing it.
+    bool next(ColumnarEvent& ev) {
+      if (_held) release();
+      const uint64_t head = _header->head.load(std::memory_order_relaxed);
+      for (size_t nwaits = 1; head == _header->tail.load(std::memory_order_acquire); ++nwaits) {
+        if (_header->closed.load(std::memory_order_acquire) && head == _header->tail.load(std::memory_order_acquire))
+          return false;
+        // The liveness check about every 10 ms
+        if (_header->aborted.load(std::memory_order_acquire) || nwaits % 500 == 0) _checkProducer();
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+      }
+      const char* slot = reinterpret_cast<const char*>(_header + 1) + (head % _header->nslots)*_header->slotBytes;
+      const size_t max = _header->maxParticles;
+      ev.weight = *reinterpret_cast<const double*>(slot);
+      ev.size = *reinterpret_cast<const uint32_t*>(slot + 8);
+      ev.px = reinterpret_cast<const double*>(slot + 16);
+      ev.py = ev.px + max; ev.pz = ev.py + max; ev.e = ev.pz + max;
+      ev.pid = reinterpret_cast<const int32_t*>(ev.e + max);
+      ev.status = ev.pid + max;
+      ev.flags = reinterpret_cast<const uint8_t*>(ev.status + max);
+      _held = true;
+      return true;
+    }
+
+    /// Hand the slot of the last event back to the producer
+    void release() {
+      if (!_held) return;
+      _header->head.fetch_add(1, std::memory_order_release);
+      _held = false;
+    }
+
+    /// Build the event @a ev as a HepMC event, in GeV, without a cross-section
+    void fillGenEvent(const ColumnarEvent& ev, HepMC::GenEvent& ge) const {
+      Rivet::fillGenEvent(ev, _header->beamPids, _header->beamEnergies, -1, -1, ge);
+    }
+
+    /// Cross-section and its error in pb, negative if the producer had none; valid once next() has returned false
+    double crossSection() const { return _header->xs; }
+    double crossSectionError() const { return _header->xserr; }
+
+
+  private:
+
+    /// Fail if the producer has aborted the ring or gone without closing it
+    void _checkProducer() const {
+      if (_header->aborted.load(std::memory_order_acquire))
+        throw UserError("The producer of the shared-memory event ring " + _name + " stopped without closing it");
+      if (_header->closed.load(std::memory_order_acquire)) return;
+      if (::kill(_header->producerPid, 0) != 0 && errno == ESRCH)
+        throw UserError("The producer of the shared-memory event ring " + _name + " (process " +
+                        toString(_header->producerPid) + ") exited without closing it");
+    }
+
+    string _name;
+    EventRingHeader* _header;
+    size_t _size;
+    bool _held;
+
+  };
+
+  //@}
+
+
+}
+
+#endif
@@ -0,0 +1,93 @@
+// -*- C++ -*-
+//
+// Convert HepMC ASCII events to a columnar event file, for fast repeated
+// runs of the analyses with runcolumns:
+//
+//   g++ -std=c++11 -I.. hepmc2columns.cc -o hepmc2columns `rivet-config --cppflags --ldflags --libs`
+//   ./hepmc2columns [--check] events.hepmc events.columns
+//
+// With --check the file is read back once written, and every rebuilt event
+// is compared with the original: it must have the same number of
+// final-state particles and the same numbers of last Z and H copies, as
+// LH2017_ZHJETS looks them up (a stable Z or H, say, must come back once).
+
+#include "EventColumns.hh"
+#include "HepMC/IO_GenEvent.h"
+#include <cstring>
+#include <iostream>
+
+using namespace Rivet;
+
+
+/// What the analyses see of an event that the columnar round trip must keep
+struct EventSummary {
+  size_t nfinal, nz, nh;
+  bool operator != (const EventSummary& other) const {
+    return nfinal != other.nfinal || nz != other.nz || nh != other.nh;
+  }
+};
+
+EventSummary summaryOf(const Event& event) {
+  size_t nfinal = 0;
+  for (const Particle& p : event.allParticles())
+    if (p.genParticle() && p.genParticle()->status() == 1) ++nfinal;
+  const EventSummary rtn = { nfinal,
+                             event.allParticles(lastParticleWith(Cuts::pid == PID::ZBOSON)).size(),
+                             event.allParticles(lastParticleWith(Cuts::pid == PID::HIGGS)).size() };
+  return rtn;
+}
+
+
+int main(int argc, char* argv[]) {
+  const bool check = argc == 4 && std::strcmp(argv[1], "--check") == 0;
+  if (argc != 3 && !check) {
+    std::cerr << "Usage: " << argv[0] << " [--check] <input.hepmc> <output.columns>" << std::endl;
+    return 1;
+  }
+  const char* inpath = argv[argc-2];
+  const char* outpath = argv[argc-1];
+
+  HepMC::IO_GenEvent in(inpath, std::ios::in);
+  if (in.rdstate() != 0) {
+    std::cerr << "Could not read " << inpath << std::endl;
+    return 1;
+  }
+  EventColumnsWriter out(outpath);
+  vector<EventSummary> summaries;
+  size_t nevents = 0;
+  for (HepMC::GenEvent* ge = in.read_next_event(); ge; ge = in.read_next_event()) {
+    out.write(*ge);
+    if (check) summaries.push_back(summaryOf(Event(*ge)));
+    delete ge;
+    ++nevents;
+  }
+  out.finish();
+  std::cout << "Wrote " << nevents << " events to " << outpath << std::endl;
+  if (!check) return 0;
+
+  // Read back and compare
+  const EventColumnsReader events(outpath);
+  size_t nbad = 0;
+  if (events.size() != nevents) {
+    std::cerr << "Read back " << events.size() << " of " << nevents << " events" << std::endl;
+    ++nbad;
+  }
+  HepMC::GenEvent ge;
+  for (size_t i = 0; i < std::min(events.size(), nevents); ++i) {
+    events.fillGenEvent(i, ge);
+    const EventSummary s = summaryOf(Event(ge));
+    if (s != summaries[i]) {
+      if (nbad < 10)
+        std::cerr << "Event " << i << ": " << summaries[i].nfinal << " final-state particles, "
+                  << summaries[i].nz << " Z and " << summaries[i].nh << " H written, but "
+                  << s.nfinal << ", " << s.nz << " and " << s.nh << " read back" << std::endl;
+      ++nbad;
+    }
+  }
+  if (nbad > 0) {
+    std::cerr << "Round-trip check of " << outpath << " failed for " << nbad << " events" << std::endl;
+    return 1;
+  }
+  std::cout << "Round-trip check of " << outpath << " passed" << std::endl;
+  return 0;
+}
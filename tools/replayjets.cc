@@ -0,0 +1,68 @@
+// -*- C++ -*-
+//
+// Replay a jet cache through one or more analyses, without reading or
+// clustering any events:
+//
+//   g++ -std=c++11 -I.. replayjets.cc -o replayjets `rivet-config --cppflags --ldflags --libs`
+//   ./replayjets jets.cache out.yoda CMS_RAD_ALL
+//
+// The cache must have been written with the analysis's WRITEJETS option and
+// the same RADII. Each cached event, vetoed or not, is passed on as an empty
+// event of the cached weight, and the analysis's READJETS option makes it
+// take the jets from the cache.
+
+#include "Rivet/AnalysisHandler.hh"
+#include "JetCache.hh"
+#include "HepMC/GenEvent.h"
+#include <cstdlib>
+#include <iostream>
+
+using namespace Rivet;
+
+
+int main(int argc, char* argv[]) {
+  if (argc < 4) {
+    std::cerr << "Usage: " << argv[0] << " <jet cache> <output.yoda> <analysis> [<analysis> ...]" << std::endl;
+    return 1;
+  }
+  const string cache = argv[1], output = argv[2];
+
+  // First pass for the event weights, the beams and the cross-section
+  vector<double> weights;
+  JetCacheReader reader(cache);
+  CachedEvent ev;
+  while (reader.next(ev)) weights.push_back(ev.weight);
+  if (weights.empty()) {
+    std::cerr << cache << " has no events" << std::endl;
+    return 1;
+  }
+
+  // The analyses read the cache themselves, in step with the events below;
+  // any other options already set are kept
+  string options = std::getenv("RIVET_ANALYSIS_OPTIONS") ? std::getenv("RIVET_ANALYSIS_OPTIONS") : "";
+  for (int i = 3; i < argc; ++i) options += string(" ") + argv[i] + ":READJETS=" + cache;
+  setenv("RIVET_ANALYSIS_OPTIONS", options.c_str(), 1);
+
+  AnalysisHandler ah;
+  ah.setIgnoreBeams(true);
+  for (int i = 3; i < argc; ++i) ah.addAnalysis(argv[i]);
+
+  const double ebeam = reader.sqrtS()/2/GeV;
+  for (double w : weights) {
+    HepMC::GenEvent ge;
+    ge.weights().push_back(w);
+    HepMC::GenVertex* v = new HepMC::GenVertex();
+    HepMC::GenParticle* b1 = new HepMC::GenParticle(HepMC::FourVector(0, 0, ebeam, ebeam), 2212, 4);
+    HepMC::GenParticle* b2 = new HepMC::GenParticle(HepMC::FourVector(0, 0, -ebeam, ebeam), 2212, 4);
+    v->add_particle_in(b1);
+    v->add_particle_in(b2);
+    ge.add_vertex(v);
+    ge.set_beam_particles(b1, b2);
+    ah.analyze(ge);
+  }
+
+  ah.setCrossSection(reader.crossSection());
+  ah.finalize();
+  ah.writeData(output);
+  return 0;
+}
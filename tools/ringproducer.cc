@@ -0,0 +1,41 @@
+// -*- C++ -*-
+//
+// Stand-in generator for the shared-memory event ring: feeds HepMC ASCII
+// events into a ring, for testing runring without a generator hooked up:
+//
+//   g++ -std=c++11 -I.. ringproducer.cc -o ringproducer `rivet-config --cppflags --ldflags --libs` -pthread -lrt
+//   ./ringproducer events.hepmc /rivet-events &
+//   ./runring /rivet-events out.yoda LH2017_ZHJETS CMS_RAD_ALL
+//
+// A real generator would do the same from its own event loop: create an
+// EventRingWriter, write() each HepMC event and close() at the end.
+
+#include "EventRing.hh"
+#include "HepMC/IO_GenEvent.h"
+#include <cstdlib>
+#include <iostream>
+
+using namespace Rivet;
+
+
+int main(int argc, char* argv[]) {
+  if (argc < 3 || argc > 5) {
+    std::cerr << "Usage: " << argv[0] << " <input.hepmc> <ring name> [<slots> [<max particles>]]" << std::endl;
+    return 1;
+  }
+  const size_t nslots = argc > 3 ? std::atol(argv[3]) : 256;
+  const size_t maxParticles = argc > 4 ? std::atol(argv[4]) : 8192;
+
+  HepMC::IO_GenEvent in(argv[1], std::ios::in);
+  if (in.rdstate() != 0) {
+    std::cerr << "Could not read " << argv[1] << std::endl;
+    return 1;
+  }
+  EventRingWriter ring(argv[2], nslots, maxParticles);
+  for (HepMC::GenEvent* ge = in.read_next_event(); ge; ge = in.read_next_event()) {
+    ring.write(*ge);
+    delete ge;
+  }
+  ring.close();
+  return 0;
+}
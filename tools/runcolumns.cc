@@ -0,0 +1,50 @@
+// -*- C++ -*-
+//
+// Run analyses over a columnar event file written by hepmc2columns:
+//
+//   g++ -std=c++11 -I.. runcolumns.cc -o runcolumns `rivet-config --cppflags --ldflags --libs` -pthread
+//   ./runcolumns events.columns out.yoda LH2017_ZHJETS CMS_RAD_ALL
+//
+// The events are built from the mapped columns, with no text parsing. With
+// RIVET_DECODE_THREADS=N they are built on N background threads while the
+// analyses run.
+
+#include "Rivet/AnalysisHandler.hh"
+#include "EventColumns.hh"
+#include "EventPipeline.hh"
+#include <iostream>
+
+using namespace Rivet;
+
+
+int main(int argc, char* argv[]) {
+  if (argc < 4) {
+    std::cerr << "Usage: " << argv[0] << " <input.columns> <output.yoda> <analysis> [<analysis> ...]" << std::endl;
+    return 1;
+  }
+
+  const EventColumnsReader events(argv[1]);
+  AnalysisHandler ah;
+  for (int i = 3; i < argc; ++i) ah.addAnalysis(argv[i]);
+
+  const size_t ndecoders = eventDecodeThreads();
+  if (ndecoders > 0) {
+    EventPipeline pipeline(ndecoders, 64, [&](size_t i, HepMC::GenEvent& ge) {
+        if (i >= events.size()) return false;
+        events.fillGenEvent(i, ge);
+        return true;
+      });
+    while (std::unique_ptr<HepMC::GenEvent> ge = pipeline.next()) ah.analyze(*ge);
+  } else {
+    HepMC::GenEvent ge;
+    for (size_t i = 0; i < events.size(); ++i) {
+      events.fillGenEvent(i, ge);
+      ah.analyze(ge);
+    }
+  }
+
+  if (events.crossSection() >= 0) ah.setCrossSection(events.crossSection());
+  ah.finalize();
+  ah.writeData(argv[2]);
+  return 0;
+}
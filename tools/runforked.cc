@@ -0,0 +1,152 @@
+// -*- C++ -*-
+//
+// Run analyses over a columnar event file in N forked worker processes, and
+// merge their histograms before one normalisation:
+//
+//   g++ -std=c++11 -I.. runforked.cc -o runforked `rivet-config --cppflags --ldflags --libs`
+//   ./runforked 8 events.columns out.yoda LH2017_ZHJETS CMS_RAD_ALL
+//
+// Each worker runs every analysis over its own range of events with the
+// RAW=1 analysis option, so that finalize() leaves its histograms unscaled,
+// and writes them to a temporary YODA file. The parent adds them into its
+// own, never filled, instances of the analyses, sets the sum of weights and
+// cross-section of the whole input, and finalizes once: the
+// crossSection()/sumOfWeights() scaling is applied exactly once, to the sum.
+// The jet cache options do not combine with it, as every worker would use
+// the same file.
+//
+// Only histograms are merged. Counters the analyses keep outside them, such
+// as the LH2017 tower-validation event count, the number of jets with
+// ga2000 > 1 and the pre-selection summary, are reported by each worker's
+// finalize() for its own range of events. The parent's instances get the
+// MERGE=1 analysis option, which tells them to leave these counters out.
+
+#include "Rivet/AnalysisHandler.hh"
+#include "Rivet/Analysis.hh"
+#include "EventColumns.hh"
+#include "YODA/ReaderYODA.h"
+#include "YODA/Histo1D.h"
+#include "YODA/Histo2D.h"
+#include "YODA/Profile1D.h"
+#include "YODA/Profile2D.h"
+#include "YODA/Counter.h"
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <sys/wait.h>
+
+using namespace Rivet;
+
+
+/// Add @a src to @a dst if both are fillable objects of the same type; false if they are not
+bool addRaw(YODA::AnalysisObject& dst, const YODA::AnalysisObject& src) {
+  if (dst.type() != src.type()) return false;
+  if (auto* h = dynamic_cast<YODA::Histo1D*>(&dst)) *h += dynamic_cast<const YODA::Histo1D&>(src);
+  else if (auto* h = dynamic_cast<YODA::Histo2D*>(&dst)) *h += dynamic_cast<const YODA::Histo2D&>(src);
+  else if (auto* p = dynamic_cast<YODA::Profile1D*>(&dst)) *p += dynamic_cast<const YODA::Profile1D&>(src);
+  else if (auto* p = dynamic_cast<YODA::Profile2D*>(&dst)) *p += dynamic_cast<const YODA::Profile2D&>(src);
+  else if (auto* c = dynamic_cast<YODA::Counter*>(&dst)) *c += dynamic_cast<const YODA::Counter&>(src);
+  else return false;
+  return true;
+}
+
+
+int main(int argc, char* argv[]) {
+  if (argc < 5 || std::atoi(argv[1]) < 1) {
+    std::cerr << "Usage: " << argv[0] << " <workers> <input.columns> <output.yoda> <analysis> [<analysis> ...]" << std::endl;
+    return 1;
+  }
+  const EventColumnsReader events(argv[2]);
+  const size_t nworkers = std::min(size_t(std::atoi(argv[1])), events.size());
+  const vector<string> ananames(argv + 4, argv + argc);
+  if (events.size() == 0) {
+    std::cerr << argv[2] << " has no events" << std::endl;
+    return 1;
+  }
+
+  char tmpl[] = "/tmp/runforked.XXXXXX";
+  if (!mkdtemp(tmpl)) {
+    std::cerr << "Could not make a temporary directory" << std::endl;
+    return 1;
+  }
+  const string tmpdir = tmpl;
+  auto rawfile = [&](size_t w) { return tmpdir + "/worker" + toString(w) + ".yoda"; };
+
+  // Workers: contiguous event ranges, raw histograms out
+  vector<pid_t> pids;
+  for (size_t w = 0; w < nworkers; ++w) {
+    const pid_t pid = fork();
+    if (pid < 0) {
+      std::cerr << "Could not fork worker " << w << std::endl;
+      return 1;
+    }
+    if (pid > 0) {
+      pids.push_back(pid);
+      continue;
+    }
+    try {
+      string options = std::getenv("RIVET_ANALYSIS_OPTIONS") ? std::getenv("RIVET_ANALYSIS_OPTIONS") : "";
+      for (const string& a : ananames) options += " " + a + ":RAW=1";
+      setenv("RIVET_ANALYSIS_OPTIONS", options.c_str(), 1);
+      AnalysisHandler ah;
+      for (const string& a : ananames) ah.addAnalysis(a);
+      HepMC::GenEvent ge;
+      const size_t first = events.size()*w/nworkers, last = events.size()*(w+1)/nworkers;
+      for (size_t i = first; i < last; ++i) {
+        events.fillGenEvent(i, ge);
+        ah.analyze(ge);
+      }
+      ah.finalize();
+      ah.writeData(rawfile(w));
+    } catch (const std::exception& e) {
+      std::cerr << "Worker " << w << ": " << e.what() << std::endl;
+      _exit(1);
+    }
+    _exit(0);
+  }
+  bool failed = false;
+  for (pid_t pid : pids) {
+    int status = 0;
+    waitpid(pid, &status, 0);
+    failed |= !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+  }
+  if (failed) {
+    std::cerr << "A worker failed; raw histograms are left in " << tmpdir << std::endl;
+    return 1;
+  }
+
+  // Parent: analyses initialised on the first event but never filled, then
+  // the workers' raw histograms added in
+  string options = std::getenv("RIVET_ANALYSIS_OPTIONS") ? std::getenv("RIVET_ANALYSIS_OPTIONS") : "";
+  for (const string& a : ananames) options += " " + a + ":MERGE=1";
+  setenv("RIVET_ANALYSIS_OPTIONS", options.c_str(), 1);
+  AnalysisHandler ah;
+  for (const string& a : ananames) ah.addAnalysis(a);
+  HepMC::GenEvent ge;
+  events.fillGenEvent(0, ge);
+  ah.init(ge);
+  std::map<string, AnalysisObjectPtr> targets;
+  for (const AnaHandle& a : ah.analyses())
+    for (const AnalysisObjectPtr& ao : a->analysisObjects()) targets[ao->path()] = ao;
+  for (size_t w = 0; w < nworkers; ++w) {
+    vector<YODA::AnalysisObject*> raw;
+    YODA::ReaderYODA::create().read(rawfile(w), raw);
+    for (YODA::AnalysisObject* ao : raw) {
+      const auto t = targets.find(ao->path());
+      if (t != targets.end() && !addRaw(*t->second, *ao))
+        std::cerr << "Not merging " << ao->path() << " of type " << ao->type() << std::endl;
+      delete ao;
+    }
+    std::remove(rawfile(w).c_str());
+  }
+  rmdir(tmpdir.c_str());
+
+  double sumw = 0;
+  for (size_t i = 0; i < events.size(); ++i) sumw += events.event(i).weight;
+  ah.setSumOfWeights(sumw);
+  if (events.crossSection() >= 0) ah.setCrossSection(events.crossSection());
+  ah.finalize();
+  ah.writeData(argv[3]);
+  return 0;
+}
@@ -0,0 +1,45 @@
+// -*- C++ -*-
+//
+// Run analyses over HepMC ASCII events, parsing them on a background thread
+// while the analyses run:
+//
+//   g++ -std=c++11 -I.. runhepmc.cc -o runhepmc `rivet-config --cppflags --ldflags --libs` -pthread
+//   ./runhepmc events.hepmc out.yoda LH2017_ZHJETS CMS_RAD_ALL
+//
+// A HepMC stream can only be parsed in order, so there is one decoder
+// thread; at most 256 parsed events are held at once.
+
+#include "Rivet/AnalysisHandler.hh"
+#include "EventPipeline.hh"
+#include "HepMC/IO_GenEvent.h"
+#include <iostream>
+
+using namespace Rivet;
+
+
+int main(int argc, char* argv[]) {
+  if (argc < 4) {
+    std::cerr << "Usage: " << argv[0] << " <input.hepmc> <output.yoda> <analysis> [<analysis> ...]" << std::endl;
+    return 1;
+  }
+
+  HepMC::IO_GenEvent in(argv[1], std::ios::in);
+  if (in.rdstate() != 0) {
+    std::cerr << "Could not read " << argv[1] << std::endl;
+    return 1;
+  }
+  AnalysisHandler ah;
+  for (int i = 3; i < argc; ++i) ah.addAnalysis(argv[i]);
+
+  EventPipeline pipeline(1, 256, [&](size_t, HepMC::GenEvent& ge) { return in.fill_next_event(&ge); });
+  double xs = -1;
+  while (std::unique_ptr<HepMC::GenEvent> ge = pipeline.next()) {
+    if (ge->cross_section()) xs = ge->cross_section()->cross_section();
+    ah.analyze(*ge);
+  }
+
+  if (xs >= 0) ah.setCrossSection(xs);
+  ah.finalize();
+  ah.writeData(argv[2]);
+  return 0;
+}
@@ -0,0 +1,44 @@
+// -*- C++ -*-
+//
+// Run analyses over events from a shared-memory event ring, as written by a
+// generator with EventRingWriter or by ringproducer:
+//
+//   g++ -std=c++11 -I.. runring.cc -o runring `rivet-config --cppflags --ldflags --libs` -pthread -lrt
+//   ./runring /rivet-events out.yoda LH2017_ZHJETS CMS_RAD_ALL
+//
+// The events are read in place in the ring, with no text on either side,
+// but each is still copied into a HepMC event for the AnalysisHandler,
+// which only takes HepMC events: this saves the text writing and parsing,
+// not the copy.
+
+#include "Rivet/AnalysisHandler.hh"
+#include "EventRing.hh"
+#include <iostream>
+
+using namespace Rivet;
+
+
+int main(int argc, char* argv[]) {
+  if (argc < 4) {
+    std::cerr << "Usage: " << argv[0] << " <ring name> <output.yoda> <analysis> [<analysis> ...]" << std::endl;
+    return 1;
+  }
+
+  EventRingReader ring(argv[1]);
+  AnalysisHandler ah;
+  for (int i = 3; i < argc; ++i) ah.addAnalysis(argv[i]);
+
+  HepMC::GenEvent ge;
+  ColumnarEvent ev;
+  while (ring.next(ev)) {
+    ring.fillGenEvent(ev, ge);
+    // The HepMC event is a copy, so the slot can go back to the producer now
+    ring.release();
+    ah.analyze(ge);
+  }
+
+  if (ring.crossSection() >= 0) ah.setCrossSection(ring.crossSection());
+  ah.finalize();
+  ah.writeData(argv[2]);
+  return 0;
+}